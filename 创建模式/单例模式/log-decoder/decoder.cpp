@@ -0,0 +1,216 @@
+// 二进制日志解码器：把 Logger 以 BINARY 格式写出的文件还原为 "[时间] [级别] 消息" 文本
+// 编译：g++ -std=c++17 -O2 decoder.cpp -o log-decoder
+// 用法：log-decoder <文件>...   MMAP_SINK 的分段文件须按序号顺序全部传入（格式串表只在流开头出现一次）
+
+#include "../logger/log_binary.hpp"
+#include "../logger/log_record.hpp"
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+
+// 顺序读取二进制流，越界时返回 false
+class Reader {
+public:
+    Reader(const char* data, size_t len) : pos(data), end(data + len) {}
+
+    bool done() const { return pos == end; }
+
+    template<typename T>
+    bool get(T& val) {
+        if (static_cast<size_t>(end - pos) < sizeof(T)) return false;
+        std::memcpy(&val, pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool varint(uint64_t& val) {
+        val = 0;
+        for (int shift = 0; shift < 64 && pos != end; shift += 7) {
+            uint8_t byte = static_cast<uint8_t>(*pos++);
+            val |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) return true;
+        }
+        return false;
+    }
+
+    // 读 varint 并检查不超过 T 的范围
+    template<typename T>
+    bool varint(T& val, uint64_t max) {
+        uint64_t v;
+        if (!varint(v) || v > max) return false;
+        val = static_cast<T>(v);
+        return true;
+    }
+
+    bool bytes(size_t len, const char*& out) {
+        if (static_cast<size_t>(end - pos) < len) return false;
+        out = pos;
+        pos += len;
+        return true;
+    }
+
+private:
+    const char* pos;
+    const char* end;
+};
+
+static const char* levelToString(uint8_t level) {
+    switch (level) {
+        case 0:  return "DEBUG";
+        case 1:  return "INFO";
+        case 2:  return "WARNING";
+        case 3:  return "ERROR";
+        default: return "UNKNOWN";
+    }
+}
+
+static bool readArgs(Reader& in, LogRecord& rec) {
+    size_t argc;
+    if (!in.varint(argc, LogRecord::kMaxArgs)) return false;
+    for (size_t i = 0; i < argc; ++i) {
+        LogArg& arg = rec.args[rec.argCount++];
+        uint8_t type;
+        uint64_t v;
+        if (!in.get(type)) return false;
+        arg.type = static_cast<LogArg::Type>(type);
+        switch (arg.type) {
+            case LogArg::INT:
+                if (!in.varint(v)) return false;
+                arg.i = logbin::unzigzag(v);
+                break;
+            case LogArg::UINT:
+                if (!in.varint(v)) return false;
+                arg.u = v;
+                break;
+            case LogArg::PTR:
+                if (!in.varint(v)) return false;
+                arg.p = reinterpret_cast<const void*>(static_cast<uintptr_t>(v));
+                break;
+            case LogArg::DOUBLE:
+                if (!in.get(arg.d)) return false;
+                break;
+            case LogArg::CHAR:
+                if (!in.get(arg.c)) return false;
+                break;
+            case LogArg::BOOL: {
+                uint8_t b;
+                if (!in.get(b)) return false;
+                arg.b = b != 0;
+                break;
+            }
+            case LogArg::STR: {
+                uint16_t len;
+                const char* data;
+                if (!in.varint(len, LogRecord::kStrBytes - rec.strUsed) || !in.bytes(len, data)) return false;
+                std::memcpy(rec.strBuf + rec.strUsed, data, len);
+                arg.s.off = rec.strUsed;
+                arg.s.len = len;
+                rec.strUsed = static_cast<uint16_t>(rec.strUsed + len);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool truncated() {
+    std::cerr << "log-decoder: truncated or corrupt record" << std::endl;
+    return false;
+}
+
+static bool decode(const std::string& data, std::ostream& out) {
+    Reader in(data.data(), data.size());
+    std::unordered_map<uint64_t, std::string> formats;  // 编号 -> 格式串
+    int64_t lastTimestamp = 0;  // 时间戳按差值存放
+    LogRecord rec;
+    std::string line;
+
+    while (!in.done()) {
+        uint8_t kind;
+        in.get(kind);
+
+        if (kind == logbin::STREAM_START) {
+            uint32_t magic;
+            uint64_t version;
+            if (!in.get(magic) || !in.varint(version) || magic != logbin::kMagic || version != logbin::kVersion) {
+                std::cerr << "log-decoder: bad stream header" << std::endl;
+                return false;
+            }
+            formats.clear();  // 新进程或新输出端，编号和时间戳基准重新开始
+            lastTimestamp = 0;
+        } else if (kind == logbin::FORMAT) {
+            uint64_t id;
+            size_t len;
+            const char* text;
+            if (!in.varint(id) || !in.varint(len, UINT32_MAX) || !in.bytes(len, text)) return truncated();
+            formats[id].assign(text, len);
+        } else if (kind == logbin::MESSAGE) {
+            uint64_t delta, fmtId;
+            if (!in.varint(delta) || !in.varint(rec.level, UINT8_MAX) ||
+                !in.varint(rec.tid, UINT32_MAX) || !in.varint(fmtId)) return truncated();
+            lastTimestamp += logbin::unzigzag(delta);
+            rec.timestamp = lastTimestamp;
+            rec.argCount = 0;
+            rec.strUsed = 0;
+            if (fmtId == 0) {
+                size_t len;
+                const char* text;
+                if (!in.varint(len, UINT32_MAX) || !in.bytes(len, text)) return truncated();
+                rec.fmt = nullptr;
+                rec.text.assign(text, len);
+            } else {
+                auto it = formats.find(fmtId);
+                if (it == formats.end()) {
+                    std::cerr << "log-decoder: unknown format id " << fmtId
+                              << " (are earlier segments missing?)" << std::endl;
+                    return false;
+                }
+                rec.fmt = it->second.c_str();
+                if (!readArgs(in, rec)) return truncated();
+            }
+
+            time_t sec = static_cast<time_t>(rec.timestamp / 1000000000);
+            char buf[26];
+            ctime_r(&sec, buf);
+            buf[24] = '\0';  // 移除换行符
+
+            line.clear();
+            line += '[';
+            line += buf;
+            line += "] [";
+            line += levelToString(rec.level);
+            line += "] ";
+            rec.appendBody(line);
+            line += '\n';
+            out << line;
+        } else {
+            std::cerr << "log-decoder: corrupt record type " << static_cast<int>(kind) << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: log-decoder <file>..." << std::endl;
+        return 1;
+    }
+
+    std::string data;
+    for (int i = 1; i < argc; ++i) {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "log-decoder: cannot open " << argv[i] << std::endl;
+            return 1;
+        }
+        data.append(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    return decode(data, std::cout) ? 0 : 1;
+}
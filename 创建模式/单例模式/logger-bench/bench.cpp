@@ -0,0 +1,184 @@
+// Logger 多线程基准：测量 log() 的入队延迟分布、持续吞吐量和落盘带宽
+// 两种实现接口相同，用 -I 选择要测的那一个：
+//   g++ -std=c++17 -O2 -pthread -I../logger       bench.cpp ../logger/logger.cpp       -o bench-logger
+//   g++ -std=c++17 -O2 -pthread -I../logger-pimpl bench.cpp ../logger-pimpl/logger.cpp -o bench-pimpl
+// 用法：bench [-t 最大线程数] [-n 每线程条数] [-s 消息长度,...] [-l 级别,...] [-p 日志路径]
+// 线程数从 1 开始翻倍直到上限；日志默认写到 tmpfs（/dev/shm），只测日志器本身而不是磁盘。
+// 运行时最低级别固定为 INFO，所以 debug 一栏测的是被过滤掉的调用。
+
+#include "logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+struct Options {
+    int maxThreads = 8;
+    size_t messages = 200000;
+    std::vector<size_t> sizes{16, 128, 1024};
+    std::vector<Logger::Level> levels{Logger::DEBUG, Logger::INFO};
+    std::string path = "/dev/shm/logger-bench.log";
+};
+
+struct Result {
+    double p50, p99, p999;  // 入队延迟，纳秒
+    double msgsPerSec;      // 从第一条开始到 flush() 返回
+    double bytesPerSec;     // 同一时间段内文件增长的字节数
+};
+
+static const char* levelName(Logger::Level level) {
+    switch (level) {
+        case Logger::DEBUG:   return "debug";
+        case Logger::INFO:    return "info";
+        case Logger::WARNING: return "warning";
+        case Logger::ERROR:   return "error";
+        default:              return "?";
+    }
+}
+
+static bool parseLevel(const std::string& name, Logger::Level& level) {
+    for (Logger::Level l : {Logger::DEBUG, Logger::INFO, Logger::WARNING, Logger::ERROR}) {
+        if (name == levelName(l)) {
+            level = l;
+            return true;
+        }
+    }
+    return false;
+}
+
+static std::vector<std::string> split(const char* arg) {
+    std::vector<std::string> parts;
+    std::string cur;
+    for (const char* p = arg; ; ++p) {
+        if (*p == ',' || *p == '\0') {
+            if (!cur.empty()) parts.push_back(cur);
+            cur.clear();
+            if (*p == '\0') break;
+        } else {
+            cur += *p;
+        }
+    }
+    return parts;
+}
+
+static bool parseOptions(int argc, char* argv[], Options& opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        const char* val = argv[i + 1];
+        if (flag == "-t") {
+            opt.maxThreads = std::max(1, std::atoi(val));
+        } else if (flag == "-n") {
+            opt.messages = std::strtoull(val, nullptr, 10);
+        } else if (flag == "-s") {
+            opt.sizes.clear();
+            for (auto& s : split(val)) opt.sizes.push_back(std::strtoull(s.c_str(), nullptr, 10));
+        } else if (flag == "-l") {
+            opt.levels.clear();
+            for (auto& s : split(val)) {
+                Logger::Level level;
+                if (!parseLevel(s, level)) return false;
+                opt.levels.push_back(level);
+            }
+        } else if (flag == "-p") {
+            opt.path = val;
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && !opt.sizes.empty() && !opt.levels.empty();
+}
+
+static long long fileSize(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+static double percentile(std::vector<uint32_t>& samples, double p) {
+    size_t idx = static_cast<size_t>(p * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return samples[idx];
+}
+
+static Result runOnce(const Options& opt, int threads, size_t size, Logger::Level level) {
+    Logger& logger = Logger::getInstance();
+    const std::string message(size, 'x');
+    std::vector<std::vector<uint32_t>> latencies(threads);
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+
+    logger.flush();
+    long long sizeBefore = fileSize(opt.path);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::vector<uint32_t>& samples = latencies[t];
+            samples.resize(opt.messages);
+            logger.log(Logger::INFO, "bench: warm-up");  // 注册本线程的缓冲，不计入延迟
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+
+            for (size_t i = 0; i < opt.messages; ++i) {
+                auto begin = std::chrono::steady_clock::now();
+                logger.log(level, message);
+                auto end = std::chrono::steady_clock::now();
+                samples[i] = static_cast<uint32_t>(std::min<long long>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count(), UINT32_MAX));
+            }
+        });
+    }
+    while (ready.load() != threads) std::this_thread::yield();
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& w : workers) w.join();
+    logger.flush();  // 全部写入文件后才停表
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<uint32_t> all;
+    all.reserve(opt.messages * threads);
+    for (auto& v : latencies) all.insert(all.end(), v.begin(), v.end());
+
+    Result r;
+    r.p50 = percentile(all, 0.50);
+    r.p99 = percentile(all, 0.99);
+    r.p999 = percentile(all, 0.999);
+    r.msgsPerSec = opt.messages * threads / seconds;
+    r.bytesPerSec = (fileSize(opt.path) - sizeBefore) / seconds;
+    return r;
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: %s [-t max_threads] [-n messages_per_thread] "
+                             "[-s size,...] [-l debug|info|warning|error,...] [-p log_path]\n", argv[0]);
+        return 1;
+    }
+
+    Logger::Config config;
+    config.path = opt.path;
+    Logger& logger = Logger::getInstance();
+    logger.configure(config);
+    logger.setLevel(Logger::INFO);
+
+    std::printf("%7s %6s %7s %9s %9s %9s %12s %10s\n",
+                "threads", "size", "level", "p50(ns)", "p99(ns)", "p99.9(ns)", "msgs/s", "MB/s");
+    for (int threads = 1; threads <= opt.maxThreads; threads *= 2) {
+        for (size_t size : opt.sizes) {
+            for (Logger::Level level : opt.levels) {
+                Result r = runOnce(opt, threads, size, level);
+                std::printf("%7d %6zu %7s %9.0f %9.0f %9.0f %12.0f %10.1f\n",
+                            threads, size, levelName(level), r.p50, r.p99, r.p999,
+                            r.msgsPerSec, r.bytesPerSec / (1024.0 * 1024.0));
+                std::fflush(stdout);
+            }
+        }
+    }
+    return 0;
+}
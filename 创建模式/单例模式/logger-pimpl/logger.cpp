@@ -1,92 +1,474 @@
-#include "Logger.hpp"
+#include "logger.hpp"
+#include "../logger/lockfree.hpp"
+#include "../logger/log_sink.hpp"
+#include "../logger/log_binary.hpp"
+#include <algorithm>
 #include <iostream>
-#include <fstream>
-#include <mutex>
-#include <queue>
+#include <memory>
+#include <vector>
 #include <thread>
+#include <mutex>
 #include <condition_variable>
 #include <chrono>
+#include <cstdio>
 #include <ctime>
 #include <atomic>
 
 class Logger::Impl {
 public:
     Impl()
-        : exitFlag(false), minLevel(DEBUG) {
-        logfile.open("app.log", std::ios_base::app);
-        if (!logfile.is_open()) {
-            std::cerr << "Logger: Failed to open log file." << std::endl;
-        }
+        : exitFlag(false), minLevel(DEBUG), startTime(std::chrono::steady_clock::now()) {
+        bufferCapacity.store(config.bufferCapacity);
+        overflowPolicy.store(config.overflow);
+        dropBelowLevel.store(config.dropBelow);
+        writeBuffer.reserve(config.flush.maxBytes + 4096);
+        lastDropReport = std::chrono::steady_clock::now();
         workerThread = std::thread(&Impl::processQueue, this);
     }
 
     ~Impl() {
-        {
-            std::lock_guard<std::mutex> lock(queueMutex);
-            exitFlag = true;
-        }
-        queueCond.notify_all();
+        exitFlag = true;
+        queueWaiter.notify();
         if (workerThread.joinable()) {
             workerThread.join();
         }
-        if (logfile.is_open()) {
-            logfile.close();
-        }
+        sink.reset();
     }
 
     void setLevel(Level level) {
         minLevel.store(level);
     }
 
+    void setFlushPolicy(const FlushPolicy& policy) {
+        {
+            std::lock_guard<std::mutex> lock(configMutex);
+            pendingConfig.flush = policy;
+        }
+        configVersion.fetch_add(1, std::memory_order_release);
+        queueWaiter.notify();
+    }
+
+    void configure(const Config& newConfig) {
+        {
+            std::lock_guard<std::mutex> lock(configMutex);
+            pendingConfig = newConfig;
+        }
+        bufferCapacity.store(newConfig.bufferCapacity);
+        overflowPolicy.store(newConfig.overflow);
+        dropBelowLevel.store(newConfig.dropBelow);
+        configVersion.fetch_add(1, std::memory_order_release);
+        queueWaiter.notify();
+    }
+
+    void flush() {
+        uint64_t ticket = flushRequested.fetch_add(1) + 1;
+        queueWaiter.notify();
+        std::unique_lock<std::mutex> lock(flushMutex);
+        flushCond.wait(lock, [this, ticket]() {
+            return flushCompleted.load() >= ticket;
+        });
+    }
+
+    Metrics metrics() const {
+        Metrics m;
+        m.uptime = std::chrono::steady_clock::now() - startTime;
+        {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            m.dropped = reapedDropped;
+            for (size_t i = 0; i < Metrics::kLatencyBuckets; ++i) {
+                m.enqueueLatency[i] = reapedLatency[i];
+            }
+            for (auto& buf : buffers) {
+                m.queueDepth += buf->ring.size();
+                m.queueCapacity += buf->ring.capacity();
+                m.dropped += buf->dropped.load(std::memory_order_relaxed);
+                for (size_t i = 0; i < Metrics::kLatencyBuckets; ++i) {
+                    m.enqueueLatency[i] += buf->latency[i].load(std::memory_order_relaxed);
+                }
+            }
+        }
+        for (uint64_t n : m.enqueueLatency) m.enqueued += n;
+        m.peakQueueDepth = std::max(peakQueueDepth.load(std::memory_order_relaxed), m.queueDepth);
+        m.messagesWritten = messagesWritten.load(std::memory_order_relaxed);
+        m.bytesWritten = bytesWritten.load(std::memory_order_relaxed);
+        m.batchesWritten = batchesWritten.load(std::memory_order_relaxed);
+        m.ioTime = std::chrono::nanoseconds(ioNanos.load(std::memory_order_relaxed));
+        return m;
+    }
+
+    bool shouldLog(Level level) const {
+        return level >= minLevel.load(std::memory_order_relaxed);
+    }
+
     void log(Level level, const std::string& message) {
         if (level < minLevel.load()) return;
 
-        std::string formatted = formatMessage(level, message);
-        {
-            std::lock_guard<std::mutex> lock(queueMutex);
-            logQueue.push(formatted);
+        LogRecord rec;
+        rec.init(level, nullptr);
+        rec.text = message;
+        submit(std::move(rec));
+    }
+
+    void submit(LogRecord&& rec) {
+        ProducerBuffer& buf = localBuffer();
+        int64_t since = rec.timestamp;
+        if (!buf.ring.tryPush(std::move(rec))) {
+            queueWaiter.notify();
+            switch (overflowPolicy.load(std::memory_order_relaxed)) {
+                case DROP_NEWEST:
+                    buf.dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                case DROP_OLDEST:
+                    while (!buf.ring.tryPush(std::move(rec))) {
+                        if (buf.ring.dropOldest()) {
+                            buf.dropped.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                    break;
+                case DROP_BELOW_LEVEL:
+                    if (rec.level < dropBelowLevel.load(std::memory_order_relaxed)) {
+                        buf.dropped.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    [[fallthrough]];
+                case BLOCK:
+                    while (!buf.ring.tryPush(std::move(rec))) {
+                        queueWaiter.notify();
+                        buf.spaceWaiter.wait([&buf]() { return buf.ring.size() < buf.ring.capacity(); });
+                    }
+                    break;
+            }
         }
-        queueCond.notify_one();
+        recordLatency(buf, since);
+        queueWaiter.notify();
     }
 
 private:
-    std::ofstream logfile;
-    std::mutex queueMutex;
-    std::condition_variable queueCond;
-    std::queue<std::string> logQueue;
+    // 每个生产者线程独占一个缓冲，线程退出后由后台线程排空并回收
+    struct ProducerBuffer {
+        explicit ProducerBuffer(size_t capacity) : ring(capacity) {}
+        SpscRing<LogRecord> ring;
+        std::atomic<bool> retired{false};
+        std::atomic<uint64_t> dropped{0};
+        SpinFutexWaiter spaceWaiter{0, 8};  // BLOCK 时所属线程在此等后台线程腾出空间；要等的后台线程可能与它共用一个核，不忙等
+        alignas(64) std::atomic<uint64_t> latency[Metrics::kLatencyBuckets] = {};  // 仅所属线程写入
+    };
+
+    static constexpr size_t kDrainBatch = 64;
+
+    mutable std::mutex buffersMutex;
+    std::vector<std::shared_ptr<ProducerBuffer>> buffers;
+    std::atomic<unsigned> buffersVersion{0};
+    SpinFutexWaiter queueWaiter;
+    std::mutex flushMutex;
+    std::condition_variable flushCond;
+    std::atomic<uint64_t> flushRequested{0};
+    std::atomic<uint64_t> flushCompleted{0};
     std::thread workerThread;
     std::atomic<bool> exitFlag;
     std::atomic<Logger::Level> minLevel;
+    std::atomic<size_t> bufferCapacity;
+    std::atomic<OverflowPolicy> overflowPolicy;
+    std::atomic<Logger::Level> dropBelowLevel;
+    std::mutex configMutex;
+    Config pendingConfig;
+    std::atomic<unsigned> configVersion{0};
+    const std::chrono::steady_clock::time_point startTime;
+    std::atomic<size_t> peakQueueDepth{0};
+    std::atomic<uint64_t> messagesWritten{0};
+    std::atomic<uint64_t> bytesWritten{0};
+    std::atomic<uint64_t> batchesWritten{0};
+    std::atomic<int64_t> ioNanos{0};
+    std::vector<std::shared_ptr<ProducerBuffer>> activeBuffers;
+    unsigned seenBuffersVersion = 0;
+    LogRecord record;
+    uint64_t reapedDropped = 0;
+    uint64_t reapedLatency[Metrics::kLatencyBuckets] = {};
+    uint64_t reportedDrops = 0;
+    std::chrono::steady_clock::time_point lastDropReport;
+    Config config;
+    unsigned appliedVersion = 0;
+    std::unique_ptr<LogSink> sink;
+    std::string writeBuffer;
+    size_t batchMessages = 0;
+    std::chrono::steady_clock::time_point batchStart;
+    logbin::Encoder encoder;
+    time_t cachedSecond = -1;
+    char cachedTime[26];
+
+    static void recordLatency(ProducerBuffer& buf, int64_t since) {
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        uint64_t ns = now > since ? static_cast<uint64_t>(now - since) : 0;
+        size_t bucket = std::min<size_t>(63 - __builtin_clzll(ns | 1), Metrics::kLatencyBuckets - 1);
+        auto& counter = buf.latency[bucket];
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    ProducerBuffer& localBuffer() {
+        struct Handle {
+            std::shared_ptr<ProducerBuffer> buf;
+            ~Handle() {
+                if (buf) buf->retired.store(true, std::memory_order_release);
+            }
+        };
+        thread_local Handle handle;
+
+        if (!handle.buf) {
+            handle.buf = std::make_shared<ProducerBuffer>(bufferCapacity.load());
+            {
+                std::lock_guard<std::mutex> lock(buffersMutex);
+                buffers.push_back(handle.buf);
+            }
+            buffersVersion.fetch_add(1, std::memory_order_release);
+        }
+        return *handle.buf;
+    }
 
     void processQueue() {
         while (true) {
-            std::unique_lock<std::mutex> lock(queueMutex);
-            queueCond.wait(lock, [this]() {
-                return !logQueue.empty() || exitFlag;
-            });
-
-            while (!logQueue.empty()) {
-                logfile << logQueue.front() << std::endl;
-                logQueue.pop();
+            long timeoutMs = nextTimeoutMs();
+            if (timeoutMs != 0) {
+                queueWaiter.wait([this]() {
+                    return hasPending() || exitFlag;
+                }, timeoutMs);
+            }
+            applyPendingConfig();
+            refreshBuffers();
+            sampleQueueDepth();
+
+            for (auto& buf : activeBuffers) {
+                drainBuffer(*buf, kDrainBatch);
             }
 
-            if (exitFlag && logQueue.empty()) {
+            if (!writeBuffer.empty() &&
+                std::chrono::steady_clock::now() - batchStart >= config.flush.maxDelay) {
+                flushBuffer();
+            }
+
+            reportDrops(false);
+            completeFlush();
+            reapRetiredBuffers();
+
+            if (exitFlag && !hasPending()) {
+                reportDrops(true);
+                flushBuffer();
                 break;
             }
         }
     }
 
-    std::string formatMessage(Level level, const std::string& message) {
-        auto now = std::chrono::system_clock::now();
-        auto time = std::chrono::system_clock::to_time_t(now);
-        char buf[26];
-        ctime_r(&time, buf);
-        buf[24] = '\0'; // Remove newline
+    bool hasPending() {
+        if (buffersVersion.load(std::memory_order_relaxed) != seenBuffersVersion ||
+            configVersion.load(std::memory_order_relaxed) != appliedVersion ||
+            flushRequested.load(std::memory_order_relaxed) != flushCompleted.load(std::memory_order_relaxed)) {
+            return true;
+        }
+        for (auto& buf : activeBuffers) {
+            if (!buf->ring.empty()) return true;
+        }
+        return false;
+    }
+
+    void refreshBuffers() {
+        unsigned version = buffersVersion.load(std::memory_order_acquire);
+        if (version == seenBuffersVersion) return;
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        activeBuffers = buffers;
+        seenBuffersVersion = version;
+    }
+
+    size_t drainBuffer(ProducerBuffer& buf, size_t maxCount) {
+        size_t count = 0;
+        while (count < maxCount && buf.ring.tryPop(record)) {
+            writeRecord(record);
+            ++count;
+        }
+        if (count > 0) buf.spaceWaiter.notify();
+        return count;
+    }
+
+    void writeRecord(const LogRecord& rec) {
+        if (writeBuffer.empty()) {
+            batchStart = std::chrono::steady_clock::now();
+        }
+        ++batchMessages;
+        if (config.format == BINARY) {
+            encoder.encode(rec, writeBuffer);
+        } else {
+            formatMessage(rec, writeBuffer);
+            writeBuffer += '\n';
+        }
+        if (writeBuffer.size() >= config.flush.maxBytes ||
+            (config.flush.flushOnError && rec.level >= ERROR)) {
+            flushBuffer();
+        }
+    }
+
+    long nextTimeoutMs() {
+        auto now = std::chrono::steady_clock::now();
+        auto deadline = std::chrono::steady_clock::time_point::max();
+        if (!writeBuffer.empty()) {
+            deadline = batchStart + config.flush.maxDelay;
+        }
+        if (droppedTotal() != reportedDrops) {
+            deadline = std::min(deadline, lastDropReport + config.dropReportInterval);
+        }
+        if (deadline == std::chrono::steady_clock::time_point::max()) return -1;
+        // 向上取整：不足 1 ms 时截断成 0 会让后台线程空转到截止时间
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
+        return left > 0 ? left : 0;
+    }
+
+    uint64_t droppedTotal() const {
+        uint64_t total = reapedDropped;
+        for (auto& buf : activeBuffers) {
+            total += buf->dropped.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    void reportDrops(bool force) {
+        auto now = std::chrono::steady_clock::now();
+        if (!force && now - lastDropReport < config.dropReportInterval) return;
+        lastDropReport = now;
+
+        uint64_t total = droppedTotal();
+        if (total == reportedDrops) return;
+        LogRecord rec;
+        rec.init(WARNING, "Logger: dropped {} messages because buffers were full ({} in total)");
+        rec.capture(total - reportedDrops);
+        rec.capture(total);
+        writeRecord(rec);
+        reportedDrops = total;
+    }
+
+    // 只取走屏障之前已发布的记录
+    void completeFlush() {
+        uint64_t requested = flushRequested.load();
+        if (requested == flushCompleted.load(std::memory_order_relaxed)) return;
+
+        refreshBuffers();
+        for (auto& buf : activeBuffers) {
+            drainBuffer(*buf, buf->ring.size());
+        }
+        reportDrops(true);
+        flushBuffer();
+        if (sink) {
+            auto begin = std::chrono::steady_clock::now();
+            sink->sync();
+            addIoTime(begin);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(flushMutex);
+            flushCompleted.store(requested);
+        }
+        flushCond.notify_all();
+    }
+
+    void reapRetiredBuffers() {
+        auto dead = [](const std::shared_ptr<ProducerBuffer>& buf) {
+            return buf->retired.load(std::memory_order_acquire) && buf->ring.empty();
+        };
+        if (std::none_of(activeBuffers.begin(), activeBuffers.end(), dead)) return;
+
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        // dead 只求值一次：生产者线程随时可能退出，两次求值之间变成 dead 的缓冲会被删掉却没有计入统计
+        auto mid = std::stable_partition(buffers.begin(), buffers.end(),
+                                         [&dead](const std::shared_ptr<ProducerBuffer>& buf) { return !dead(buf); });
+        for (auto it = mid; it != buffers.end(); ++it) {
+            reapedDropped += (*it)->dropped.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < Metrics::kLatencyBuckets; ++i) {
+                reapedLatency[i] += (*it)->latency[i].load(std::memory_order_relaxed);
+            }
+        }
+        buffers.erase(mid, buffers.end());
+        activeBuffers = buffers;
+    }
+
+    void applyPendingConfig() {
+        unsigned version = configVersion.load(std::memory_order_acquire);
+        if (version == appliedVersion) return;
+
+        Config next;
+        {
+            std::lock_guard<std::mutex> lock(configMutex);
+            next = pendingConfig;
+        }
+        appliedVersion = version;
 
-        return "[" + std::string(buf) + "] [" + levelToString(level) + "] " + message;
+        bool sinkChanged = next.path != config.path || next.sink != config.sink ||
+                           next.segmentBytes != config.segmentBytes ||
+                           next.rotateInterval != config.rotateInterval;
+        if (sinkChanged || next.format != config.format) {
+            flushBuffer();
+            encoder.reset();
+        }
+        if (sinkChanged) {
+            sink.reset();  // 新的输出端在下一次写出时创建
+        }
+        config = next;
+        writeBuffer.reserve(config.flush.maxBytes + 4096);
     }
 
-    std::string levelToString(Level level) {
+    void flushBuffer() {
+        if (!writeBuffer.empty()) {
+            if (!sink) sink = makeSink(config);  // 第一次写出时才打开，configure() 之前不会创建默认文件
+            auto begin = std::chrono::steady_clock::now();
+            sink->write(writeBuffer.data(), writeBuffer.size());
+            addIoTime(begin);
+            messagesWritten.store(messagesWritten.load(std::memory_order_relaxed) + batchMessages,
+                                  std::memory_order_relaxed);
+            bytesWritten.store(bytesWritten.load(std::memory_order_relaxed) + writeBuffer.size(),
+                               std::memory_order_relaxed);
+            batchesWritten.store(batchesWritten.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        writeBuffer.clear();
+        batchMessages = 0;
+    }
+
+    // 每轮取数前积压最多，在这里采样峰值
+    void sampleQueueDepth() {
+        size_t depth = 0;
+        for (auto& buf : activeBuffers) {
+            depth += buf->ring.size();
+        }
+        if (depth > peakQueueDepth.load(std::memory_order_relaxed)) {
+            peakQueueDepth.store(depth, std::memory_order_relaxed);
+        }
+    }
+
+    void addIoTime(std::chrono::steady_clock::time_point since) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since);
+        ioNanos.store(ioNanos.load(std::memory_order_relaxed) + ns.count(), std::memory_order_relaxed);
+    }
+
+    static std::unique_ptr<LogSink> makeSink(const Config& config) {
+        if (config.sink == MMAP_SINK) {
+            return std::make_unique<MmapSink>(config.path, config.segmentBytes, config.rotateInterval);
+        }
+        return std::make_unique<FileSink>(config.path);
+    }
+
+    void formatMessage(const LogRecord& rec, std::string& out) {
+        time_t sec = static_cast<time_t>(rec.timestamp / 1000000000);
+        if (sec != cachedSecond) {
+            ctime_r(&sec, cachedTime);
+            cachedTime[24] = '\0'; // Remove newline
+            cachedSecond = sec;
+        }
+
+        out += '[';
+        out += cachedTime;
+        out += "] [";
+        out += levelToString(static_cast<Level>(rec.level));
+        out += "] ";
+
+        rec.appendBody(out);
+    }
+
+    static const char* levelToString(Level level) {
         switch (level) {
             case DEBUG:   return "DEBUG";
             case INFO:    return "INFO";
@@ -118,6 +500,30 @@ void Logger::setLevel(Level level) {
     pImpl->setLevel(level);
 }
 
+void Logger::setFlushPolicy(const FlushPolicy& policy) {
+    pImpl->setFlushPolicy(policy);
+}
+
+void Logger::configure(const Config& config) {
+    pImpl->configure(config);
+}
+
+void Logger::flush() {
+    pImpl->flush();
+}
+
 void Logger::log(Level level, const std::string& message) {
     pImpl->log(level, message);
 }
+
+bool Logger::shouldLog(Level level) const {
+    return pImpl->shouldLog(level);
+}
+
+Logger::Metrics Logger::metrics() const {
+    return pImpl->metrics();
+}
+
+void Logger::submit(LogRecord&& rec) {
+    pImpl->submit(std::move(rec));
+}
@@ -1,14 +1,100 @@
 #pragma once
 #include <string>
+#include <type_traits>
+#include <chrono>
+#include "../logger/log_record.hpp"
 
 class Logger {
 public:
     enum Level { DEBUG, INFO, WARNING, ERROR };
 
+    // 刷盘策略：满足任一条件时，整批日志一次 write 出去
+    struct FlushPolicy {
+        size_t maxBytes = 64 * 1024;
+        std::chrono::milliseconds maxDelay{100};
+        bool flushOnError = true;
+    };
+
+    enum SinkType { FILE_SINK, MMAP_SINK };
+
+    // BINARY 输出紧凑二进制记录（见 log_binary.hpp），用 log-decoder 还原为文本
+    enum OutputFormat { TEXT, BINARY };
+
+    // 线程缓冲写满时：等待 / 丢弃当前这条 / 丢弃最旧一条 / 低于 dropBelow 的丢弃、其余等待
+    enum OverflowPolicy { BLOCK, DROP_NEWEST, DROP_OLDEST, DROP_BELOW_LEVEL };
+
+    // 日志输出配置；MMAP_SINK 写入分段文件 <path>.<序号>，按大小或时间滚动
+    struct Config {
+        std::string path = "app.log";
+        SinkType sink = FILE_SINK;
+        OutputFormat format = TEXT;
+        size_t segmentBytes = 64 * 1024 * 1024;
+        std::chrono::seconds rotateInterval{0};
+        FlushPolicy flush;
+        size_t bufferCapacity = 1024;  // 对之后首次写日志的线程生效
+        OverflowPolicy overflow = BLOCK;
+        Level dropBelow = WARNING;
+        std::chrono::seconds dropReportInterval{10};
+    };
+
+    // 运行指标快照，计数器自 Logger 创建起累计；速率由两次快照之差除以 uptime 之差得到
+    struct Metrics {
+        static constexpr size_t kLatencyBuckets = 32;
+
+        std::chrono::nanoseconds uptime{0};
+        size_t queueDepth = 0;       // 各线程缓冲中未取走的条数
+        size_t peakQueueDepth = 0;
+        size_t queueCapacity = 0;
+        uint64_t enqueued = 0;
+        uint64_t dropped = 0;
+        uint64_t enqueueLatency[kLatencyBuckets] = {};  // 第 i 格：入队耗时在 [2^i, 2^(i+1)) 纳秒内
+        uint64_t messagesWritten = 0;
+        uint64_t bytesWritten = 0;
+        uint64_t batchesWritten = 0;
+        std::chrono::nanoseconds ioTime{0};  // 输出端 write / sync 耗时
+
+        // 入队耗时的 p 分位（0~1），返回所在格的上界（纳秒）
+        uint64_t enqueueLatencyPercentile(double p) const {
+            if (enqueued == 0) return 0;
+            uint64_t rank = static_cast<uint64_t>(p * enqueued);
+            uint64_t seen = 0;
+            for (size_t i = 0; i < kLatencyBuckets; ++i) {
+                seen += enqueueLatency[i];
+                if (seen > rank || seen == enqueued) return uint64_t(1) << (i + 1);
+            }
+            return uint64_t(1) << kLatencyBuckets;
+        }
+    };
+
     static Logger& getInstance();
 
     void setLevel(Level level);
+    void setFlushPolicy(const FlushPolicy& policy);
+    void configure(const Config& config);
+    void flush();  // 返回时，调用前已入队的日志都已写入并落盘
     void log(Level level, const std::string& message);
+    bool shouldLog(Level level) const;
+    Metrics metrics() const;  // 任意线程可调用，不阻塞日志路径
+
+    // 只有通过运行时级别检查后才调用 makeMessage()
+    template<typename F, typename = std::enable_if_t<std::is_invocable_r_v<std::string, F&>>>
+    void log(Level level, F&& makeMessage) {
+        if (!shouldLog(level)) return;
+        LogRecord rec;
+        rec.init(level, nullptr);
+        rec.text = makeMessage();
+        submit(std::move(rec));
+    }
+
+    // fmt 必须是字符串字面量，"{}" 在后台线程中依次替换为参数
+    template<typename... Args>
+    void logf(Level level, const char* fmt, const Args&... args) {
+        if (!shouldLog(level)) return;
+        LogRecord rec;
+        rec.init(level, fmt);
+        (rec.capture(args), ...);
+        submit(std::move(rec));
+    }
 
 private:
     Logger();
@@ -17,10 +103,44 @@ private:
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
 
-    void processQueue();
-    std::string formatMessage(Level level, const std::string& message);
-    std::string levelToString(Level level);
+    void submit(LogRecord&& rec);
 
     class Impl;
     Impl* pImpl;
 };
+
+// ------------------- 日志宏 --------------------
+// 编译期最低级别：0=DEBUG 1=INFO 2=WARNING 3=ERROR，低于该级别的宏展开为空语句，参数也不会被求值。
+// 默认 Release（定义了 NDEBUG）去掉 DEBUG，可在编译命令中用 -DLOGGER_COMPILE_LEVEL=N 覆盖。
+#ifndef LOGGER_COMPILE_LEVEL
+#ifdef NDEBUG
+#define LOGGER_COMPILE_LEVEL 1
+#else
+#define LOGGER_COMPILE_LEVEL 0
+#endif
+#endif
+
+// 用法与 logf 相同：LOG_INFO("user {} login", id)
+#if LOGGER_COMPILE_LEVEL <= 0
+#define LOG_DEBUG(...) Logger::getInstance().logf(Logger::DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOGGER_COMPILE_LEVEL <= 1
+#define LOG_INFO(...) Logger::getInstance().logf(Logger::INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOGGER_COMPILE_LEVEL <= 2
+#define LOG_WARNING(...) Logger::getInstance().logf(Logger::WARNING, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) ((void)0)
+#endif
+
+#if LOGGER_COMPILE_LEVEL <= 3
+#define LOG_ERROR(...) Logger::getInstance().logf(Logger::ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
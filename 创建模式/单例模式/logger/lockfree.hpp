@@ -0,0 +1,185 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// ------------------- 有界无锁 SPSC 环形队列 --------------------
+// 每个生产者线程独占一个队列，后台线程是唯一的消费者。
+// 为支持“丢弃最旧”，生产者也可以从队头取走元素：队头用 CAS 认领，
+// 槽位序号保证认领者读完之前生产者不会覆盖该槽位。
+template<typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : mask(roundUpPow2(capacity) - 1), slots(new Slot[mask + 1]) {
+        for (size_t i = 0; i <= mask; ++i) {
+            slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // 仅限生产者线程调用；队列满时返回 false，val 保持不变
+    template<typename U>
+    bool tryPush(U&& val) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - headCache > mask) {
+            headCache = head.load(std::memory_order_acquire);
+            if (t - headCache > mask) return false;
+        }
+        Slot& slot = slots[t & mask];
+        while (slot.seq.load(std::memory_order_acquire) != t) {
+            cpuRelax();  // 上一圈的认领者还在读这个槽位
+        }
+        slot.val = std::forward<U>(val);
+        slot.seq.store(t + 1, std::memory_order_release);
+        tail.store(t + 1, std::memory_order_release);  // 发布给消费者
+        return true;
+    }
+
+    // 消费者取走队头
+    bool tryPop(T& out) {
+        Slot* slot = claimHead();
+        if (slot == nullptr) return false;
+        out = std::move(slot->val);
+        release(*slot);
+        return true;
+    }
+
+    // 生产者丢弃队头（最旧的元素），与 tryPop 竞争同一个队头
+    bool dropOldest() {
+        Slot* slot = claimHead();
+        if (slot == nullptr) return false;
+        T discarded = std::move(slot->val);
+        release(*slot);
+        return true;
+    }
+
+    // 仅限消费者线程调用
+    bool empty() const {
+        size_t h = head.load(std::memory_order_acquire);
+        return slots[h & mask].seq.load(std::memory_order_acquire) != h + 1;
+    }
+
+    // 当前已发布未取走的元素个数（近似值，任意线程可调用）
+    size_t size() const {
+        size_t t = tail.load(std::memory_order_acquire);
+        size_t h = head.load(std::memory_order_acquire);
+        return t >= h ? t - h : 0;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<size_t> seq;  // == 位置+1 表示有数据；== 位置 表示可写
+        T val;
+    };
+
+    static size_t roundUpPow2(size_t n) {
+        size_t cap = 2;
+        while (cap < n) cap <<= 1;
+        return cap;
+    }
+
+    Slot* claimHead() {
+        size_t h = head.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[h & mask];
+            if (slot.seq.load(std::memory_order_acquire) != h + 1) return nullptr;
+            if (head.compare_exchange_weak(h, h + 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                return &slot;  // 独占该槽位，直到 release()
+            }
+        }
+    }
+
+    void release(Slot& slot) {
+        size_t seq = slot.seq.load(std::memory_order_relaxed);
+        slot.seq.store(seq + mask, std::memory_order_release);  // (位置+1)+mask == 下一圈的位置
+    }
+
+    const size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    alignas(64) std::atomic<size_t> tail{0};  // 生产者写
+    size_t headCache = 0;                     // 生产者缓存的 head
+    alignas(64) std::atomic<size_t> head{0};  // 消费者和“丢弃最旧”的生产者 CAS 认领
+};
+
+// ------------------- 先自旋、后 futex 的等待器 --------------------
+// 消费者先忙等一小段时间，仍无数据才进入内核睡眠；
+// 生产者只有在消费者确实睡着时才发起 FUTEX_WAKE 系统调用。
+class SpinFutexWaiter {
+public:
+    // spins / yields：进入内核睡眠前忙等和让出 CPU 的次数。等待方要等的线程可能需要同一个核时应取小一些
+    explicit SpinFutexWaiter(int spins = kSpinCount, int yields = kYieldCount) : spins(spins), yields(yields) {}
+
+    // 消费者调用：直到 ready() 为真或超时（timeoutMs < 0 表示不超时）才返回
+    template<typename Pred>
+    void wait(Pred ready, long timeoutMs = -1) {
+        for (int i = 0; i < spins; ++i) {
+            if (ready()) return;
+            cpuRelax();
+        }
+        for (int i = 0; i < yields; ++i) {
+            if (ready()) return;
+            std::this_thread::yield();
+        }
+
+        uint32_t seq = word.load(std::memory_order_acquire);
+        sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);  // 与 notify() 中的栅栏配对
+        if (!ready()) {
+            futexWait(seq, timeoutMs);
+        }
+        sleeping.store(false, std::memory_order_relaxed);
+    }
+
+    // 生产者调用：发布数据之后
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed)) {
+            word.fetch_add(1, std::memory_order_release);
+            syscall(SYS_futex, futexAddr(), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+        }
+    }
+
+private:
+    static constexpr int kSpinCount = 2000;
+    static constexpr int kYieldCount = 50;
+
+    const int spins;
+    const int yields;
+    std::atomic<uint32_t> word{0};
+    std::atomic<bool> sleeping{false};
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be 32-bit");
+
+    uint32_t* futexAddr() { return reinterpret_cast<uint32_t*>(&word); }
+
+    void futexWait(uint32_t seq, long timeoutMs) {
+        if (timeoutMs < 0) {
+            syscall(SYS_futex, futexAddr(), FUTEX_WAIT_PRIVATE, seq, nullptr, nullptr, 0);
+        } else {
+            timespec ts;
+            ts.tv_sec = timeoutMs / 1000;
+            ts.tv_nsec = (timeoutMs % 1000) * 1000000L;
+            syscall(SYS_futex, futexAddr(), FUTEX_WAIT_PRIVATE, seq, &ts, nullptr, 0);
+        }
+    }
+};
@@ -0,0 +1,120 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include "log_record.hpp"
+
+// ------------------- 二进制日志格式 --------------------
+// 日志流由若干条目组成，每个条目以 1 字节类型开头。
+// 整数一律用 varint（每字节 7 位，小端在前），有符号数先做 zigzag；double 按本机字节序存 8 字节。
+//   STREAM_START : magic(u32 定长) version(varint)
+//                  每次打开输出端时写一次，编码/解码双方据此清空格式串表和时间戳基准
+//   FORMAT       : id len 格式串
+//                  某个格式串在本流中第一次出现时写入
+//   MESSAGE      : 时间戳差值(zigzag，相对本流上一条 MESSAGE，纳秒) level tid fmtId
+//                  fmtId == 0：len 文本，即 log(level, message) 的完整消息
+//                  fmtId != 0：argc，随后每个参数为 type(1 字节) + 值：
+//                  INT zigzag、UINT/PTR varint、DOUBLE 8 字节、CHAR/BOOL 1 字节、STR len + 字节
+namespace logbin {
+
+constexpr uint8_t STREAM_START = 1;
+constexpr uint8_t FORMAT = 2;
+constexpr uint8_t MESSAGE = 3;
+
+constexpr uint32_t kMagic = 0x42474F4C;  // 小端下为 "LOGB"
+constexpr uint64_t kVersion = 1;
+
+inline uint64_t zigzag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+inline int64_t unzigzag(uint64_t v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+inline void putVarint(std::string& out, uint64_t v) {
+    char buf[10];
+    size_t n = 0;
+    while (v >= 0x80) {
+        buf[n++] = static_cast<char>(v | 0x80);
+        v >>= 7;
+    }
+    buf[n++] = static_cast<char>(v);
+    out.append(buf, n);
+}
+
+template<typename T>
+inline void putRaw(std::string& out, T val) {
+    out.append(reinterpret_cast<const char*>(&val), sizeof(val));
+}
+
+// 编码器：格式串按地址编号（fmt 是字符串字面量，地址唯一且不变），只在第一次出现时写出全文
+class Encoder {
+public:
+    // 换了输出端或格式后调用，下一条记录前会重新写流头
+    void reset() { started = false; }
+
+    void encode(const LogRecord& rec, std::string& out) {
+        if (!started) {
+            out += static_cast<char>(STREAM_START);
+            putRaw<uint32_t>(out, kMagic);
+            putVarint(out, kVersion);
+            formatIds.clear();
+            lastTimestamp = 0;
+            started = true;
+        }
+
+        uint64_t fmtId = 0;
+        if (rec.fmt != nullptr) {
+            auto it = formatIds.find(rec.fmt);
+            if (it == formatIds.end()) {
+                fmtId = formatIds.size() + 1;
+                formatIds.emplace(rec.fmt, fmtId);
+                size_t len = std::strlen(rec.fmt);
+                out += static_cast<char>(FORMAT);
+                putVarint(out, fmtId);
+                putVarint(out, len);
+                out.append(rec.fmt, len);
+            } else {
+                fmtId = it->second;
+            }
+        }
+
+        out += static_cast<char>(MESSAGE);
+        putVarint(out, zigzag(rec.timestamp - lastTimestamp));
+        lastTimestamp = rec.timestamp;
+        putVarint(out, rec.level);
+        putVarint(out, rec.tid);
+        putVarint(out, fmtId);
+        if (fmtId == 0) {
+            putVarint(out, rec.text.size());
+            out += rec.text;
+            return;
+        }
+        putVarint(out, rec.argCount);
+        for (size_t i = 0; i < rec.argCount; ++i) {
+            const LogArg& arg = rec.args[i];
+            out += static_cast<char>(arg.type);
+            switch (arg.type) {
+                case LogArg::INT:    putVarint(out, zigzag(arg.i)); break;
+                case LogArg::UINT:   putVarint(out, arg.u); break;
+                case LogArg::DOUBLE: putRaw<double>(out, arg.d); break;
+                case LogArg::PTR:    putVarint(out, reinterpret_cast<uintptr_t>(arg.p)); break;
+                case LogArg::CHAR:   out += arg.c; break;
+                case LogArg::BOOL:   out += static_cast<char>(arg.b ? 1 : 0); break;
+                case LogArg::STR:
+                    putVarint(out, arg.s.len);
+                    out.append(rec.strBuf + arg.s.off, arg.s.len);
+                    break;
+            }
+        }
+    }
+
+private:
+    bool started = false;
+    int64_t lastTimestamp = 0;
+    std::unordered_map<const char*, uint64_t> formatIds;
+};
+
+}  // namespace logbin
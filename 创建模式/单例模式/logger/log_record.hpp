@@ -0,0 +1,132 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// ------------------- 延迟格式化的日志记录 --------------------
+// 调用线程只保存时间戳、级别和参数原始值，字符串拼接全部推迟到后台线程。
+
+struct LogArg {
+    enum Type : uint8_t { INT, UINT, DOUBLE, CHAR, BOOL, STR, PTR };
+
+    Type type;
+    union {
+        long long i;
+        unsigned long long u;
+        double d;
+        char c;
+        bool b;
+        const void* p;
+        struct { uint16_t off, len; } s;  // 字符串参数拷贝在 LogRecord::strBuf 中的位置
+    };
+};
+
+// 内核线程号，每个线程只查询一次
+inline uint32_t currentThreadId() {
+    thread_local uint32_t tid = static_cast<uint32_t>(::syscall(SYS_gettid));
+    return tid;
+}
+
+struct LogRecord {
+    static constexpr size_t kMaxArgs = 8;     // 超出的参数被忽略
+    static constexpr size_t kStrBytes = 128;  // 字符串参数总长度上限，超出部分截断
+
+    int64_t timestamp;   // system_clock 纪元以来的纳秒数
+    uint8_t level;
+    uint8_t argCount;
+    uint16_t strUsed;
+    uint32_t tid;        // 写日志的线程
+    const char* fmt;     // logf 的格式串，必须是字符串字面量；为 nullptr 时消息在 text 中
+    LogArg args[kMaxArgs];
+    char strBuf[kStrBytes];
+    std::string text;    // log(level, message) 的完整消息
+
+    void init(int lvl, const char* format) {
+        timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        level = static_cast<uint8_t>(lvl);
+        tid = currentThreadId();
+        argCount = 0;
+        strUsed = 0;
+        fmt = format;
+    }
+
+    template<typename T>
+    void capture(const T& val) {
+        if (argCount == kMaxArgs) return;
+        LogArg& arg = args[argCount++];
+        if constexpr (std::is_same_v<T, bool>) {
+            arg.type = LogArg::BOOL;
+            arg.b = val;
+        } else if constexpr (std::is_same_v<T, char>) {
+            arg.type = LogArg::CHAR;
+            arg.c = val;
+        } else if constexpr (std::is_enum_v<T>) {
+            arg.type = LogArg::INT;
+            arg.i = static_cast<long long>(val);
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            arg.type = LogArg::INT;
+            arg.i = val;
+        } else if constexpr (std::is_integral_v<T>) {
+            arg.type = LogArg::UINT;
+            arg.u = val;
+        } else if constexpr (std::is_floating_point_v<T>) {
+            arg.type = LogArg::DOUBLE;
+            arg.d = static_cast<double>(val);
+        } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            std::string_view sv;
+            if constexpr (std::is_pointer_v<T>) {
+                sv = val != nullptr ? std::string_view(val) : std::string_view("(null)");  // 空指针不能构造 string_view
+            } else {
+                sv = val;
+            }
+            size_t n = sv.size() < kStrBytes - strUsed ? sv.size() : kStrBytes - strUsed;
+            std::memcpy(strBuf + strUsed, sv.data(), n);
+            arg.type = LogArg::STR;
+            arg.s.off = strUsed;
+            arg.s.len = static_cast<uint16_t>(n);
+            strUsed = static_cast<uint16_t>(strUsed + n);
+        } else if constexpr (std::is_pointer_v<T>) {
+            arg.type = LogArg::PTR;
+            arg.p = static_cast<const void*>(val);
+        } else {
+            static_assert(sizeof(T) == 0, "logf: unsupported argument type");
+        }
+    }
+
+    // 追加消息正文（不含时间和级别）：text 原样输出，或把 fmt 中的 "{}" 依次替换为参数
+    void appendBody(std::string& out) const {
+        if (fmt == nullptr) {
+            out += text;
+            return;
+        }
+        size_t next = 0;
+        for (const char* p = fmt; *p; ++p) {
+            if (p[0] == '{' && p[1] == '}' && next < argCount) {
+                appendArg(args[next++], out);
+                ++p;
+            } else {
+                out += *p;
+            }
+        }
+    }
+
+    void appendArg(const LogArg& arg, std::string& out) const {
+        char buf[32];
+        switch (arg.type) {
+            case LogArg::INT:    out.append(buf, std::snprintf(buf, sizeof(buf), "%lld", arg.i)); break;
+            case LogArg::UINT:   out.append(buf, std::snprintf(buf, sizeof(buf), "%llu", arg.u)); break;
+            case LogArg::DOUBLE: out.append(buf, std::snprintf(buf, sizeof(buf), "%g", arg.d)); break;
+            case LogArg::PTR:    out.append(buf, std::snprintf(buf, sizeof(buf), "%p", arg.p)); break;
+            case LogArg::CHAR:   out += arg.c; break;
+            case LogArg::BOOL:   out += arg.b ? "true" : "false"; break;
+            case LogArg::STR:    out.append(strBuf + arg.s.off, arg.s.len); break;
+        }
+    }
+};
@@ -0,0 +1,175 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// ------------------- 日志输出端 --------------------
+// 只由后台线程调用，生产者永远不会因为写文件或滚动而阻塞。
+class LogSink {
+public:
+    virtual void write(const char* data, size_t len) = 0;
+    virtual void sync() = 0;  // 已写入的数据落盘
+    virtual ~LogSink() = default;
+};
+
+// 追加写普通文件：每批日志一次 write(2)
+class FileSink : public LogSink {
+public:
+    explicit FileSink(const std::string& path) {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            std::cerr << "Logger: Failed to open log file." << std::endl;
+        }
+    }
+
+    ~FileSink() override {
+        if (fd >= 0) ::close(fd);
+    }
+
+    void write(const char* data, size_t len) override {
+        while (len > 0 && fd >= 0) {
+            ssize_t n = ::write(fd, data, len);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "Logger: Failed to write log file." << std::endl;
+                return;
+            }
+            data += n;
+            len -= static_cast<size_t>(n);
+        }
+    }
+
+    void sync() override {
+        if (fd >= 0) ::fdatasync(fd);
+    }
+
+private:
+    int fd;
+};
+
+// 内存映射分段文件：<path>.<序号>，每段预先分配 segmentBytes 字节，
+// 日志直接 memcpy 进映射区；写满或超过 rotateInterval 即切换到下一段。
+// 下一段总是提前建好，滚动只是一次交换。
+class MmapSink : public LogSink {
+public:
+    MmapSink(const std::string& path, size_t segmentBytes, std::chrono::seconds rotateInterval)
+        : basePath(path), segmentBytes(segmentBytes), rotateInterval(rotateInterval) {
+        current = openSegment();
+        next = openSegment();
+        openedAt = std::chrono::steady_clock::now();
+    }
+
+    ~MmapSink() override {
+        closeSegment(current);
+        discardSegment(next);
+    }
+
+    void write(const char* data, size_t len) override {
+        if (rotateInterval.count() > 0 && current.used > 0 &&
+            std::chrono::steady_clock::now() - openedAt >= rotateInterval) {
+            rotate();
+        }
+        if (len <= segmentBytes && len > segmentBytes - current.used) {
+            rotate();  // 整批放得下新段时不跨段拆分
+        }
+        while (len > 0 && current.base != nullptr) {
+            if (current.used == segmentBytes) {
+                rotate();
+                continue;
+            }
+            size_t n = std::min(len, segmentBytes - current.used);
+            std::memcpy(current.base + current.used, data, n);
+            current.used += n;
+            data += n;
+            len -= n;
+        }
+    }
+
+    void sync() override {
+        if (current.base != nullptr && current.used > 0) {
+            ::msync(current.base, current.used, MS_SYNC);
+        }
+    }
+
+private:
+    struct Segment {
+        std::string path;
+        int fd = -1;
+        char* base = nullptr;
+        size_t used = 0;
+    };
+
+    std::string basePath;
+    size_t segmentBytes;
+    std::chrono::seconds rotateInterval;
+    unsigned nextIndex = 0;
+    Segment current;
+    Segment next;
+    std::chrono::steady_clock::time_point openedAt;
+
+    void rotate() {
+        closeSegment(current);
+        current = next.base != nullptr ? next : openSegment();
+        next = openSegment();
+        openedAt = std::chrono::steady_clock::now();
+    }
+
+    Segment openSegment() {
+        Segment seg;
+        int fd = -1;
+        while (fd < 0) {  // 跳过已存在的段，绝不覆盖旧日志
+            seg.path = basePath + "." + std::to_string(nextIndex++);
+            fd = ::open(seg.path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+            if (fd < 0 && errno != EEXIST) {
+                std::cerr << "Logger: Failed to create log segment " << seg.path << std::endl;
+                return Segment();
+            }
+        }
+        if (posix_fallocate(fd, 0, static_cast<off_t>(segmentBytes)) != 0) {  // 预分配，避免写映射时 SIGBUS
+            std::cerr << "Logger: Failed to allocate log segment " << seg.path << std::endl;
+            ::close(fd);
+            ::unlink(seg.path.c_str());
+            return Segment();
+        }
+        void* addr = ::mmap(nullptr, segmentBytes, PROT_WRITE, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            std::cerr << "Logger: Failed to map log segment " << seg.path << std::endl;
+            ::close(fd);
+            ::unlink(seg.path.c_str());
+            return Segment();
+        }
+        seg.fd = fd;
+        seg.base = static_cast<char*>(addr);
+        return seg;
+    }
+
+    // 先把写入的部分刷到磁盘（sync() 只管当前段，轮转出去的段要在这里刷），
+    // 再截断到实际写入的长度，不在文件末尾留下一串 '\0'
+    void closeSegment(Segment& seg) {
+        if (seg.base == nullptr) return;
+        if (seg.used > 0 && ::msync(seg.base, seg.used, MS_SYNC) != 0) {
+            std::cerr << "Logger: Failed to sync log segment " << seg.path << std::endl;
+        }
+        ::munmap(seg.base, segmentBytes);
+        if (::ftruncate(seg.fd, static_cast<off_t>(seg.used)) != 0) {
+            std::cerr << "Logger: Failed to truncate log segment " << seg.path << std::endl;
+        }
+        ::close(seg.fd);
+        seg = Segment();
+    }
+
+    // 预分配但从未使用的段直接删除
+    void discardSegment(Segment& seg) {
+        if (seg.base == nullptr) return;
+        ::munmap(seg.base, segmentBytes);
+        ::close(seg.fd);
+        ::unlink(seg.path.c_str());
+        seg = Segment();
+    }
+};
@@ -1,28 +1,25 @@
 #include "logger.hpp"
+#include "log_sink.hpp"
+#include <algorithm>
 #include <iostream>
-#include <ctime>
-#include <chrono>
+#include <cstdio>
 
-Logger::Logger() : exitFlag(false), minLevel(DEBUG) {
-    logfile.open("app.log", std::ios_base::app);  // 打开日志文件
-    if (!logfile.is_open()) {
-        std::cerr << "Logger: Failed to open log file." << std::endl;
-    }
+Logger::Logger() : exitFlag(false), minLevel(DEBUG), startTime(std::chrono::steady_clock::now()) {
+    bufferCapacity.store(config.bufferCapacity);
+    overflowPolicy.store(config.overflow);
+    dropBelowLevel.store(config.dropBelow);
+    writeBuffer.reserve(config.flush.maxBytes + 4096);
+    lastDropReport = std::chrono::steady_clock::now();
     workerThread = std::thread(&Logger::processQueue, this);  // 启动后台线程
 }
 
 Logger::~Logger() {
-    {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        exitFlag = true;  // 设置退出标志
-    }
-    queueCond.notify_all();
+    exitFlag = true;  // 设置退出标志
+    queueWaiter.notify();
     if (workerThread.joinable()) {
         workerThread.join();  // 等待后台线程结束
     }
-    if (logfile.is_open()) {
-        logfile.close();  // 关闭文件
-    }
+    sink.reset();  // 关闭文件
 }
 
 Logger& Logger::getInstance() {
@@ -34,46 +31,381 @@ void Logger::setLevel(Level level) {
     minLevel.store(level);  // 设置最低日志级别
 }
 
+void Logger::setFlushPolicy(const FlushPolicy& policy) {
+    {
+        std::lock_guard<std::mutex> lock(configMutex);
+        pendingConfig.flush = policy;
+    }
+    configVersion.fetch_add(1, std::memory_order_release);  // 后台线程下一轮循环时取用
+    queueWaiter.notify();
+}
+
+void Logger::configure(const Config& newConfig) {
+    {
+        std::lock_guard<std::mutex> lock(configMutex);
+        pendingConfig = newConfig;
+    }
+    bufferCapacity.store(newConfig.bufferCapacity);
+    overflowPolicy.store(newConfig.overflow);
+    dropBelowLevel.store(newConfig.dropBelow);
+    configVersion.fetch_add(1, std::memory_order_release);  // 打开新文件由后台线程完成，不阻塞调用者
+    queueWaiter.notify();
+}
+
+void Logger::flush() {
+    uint64_t ticket = flushRequested.fetch_add(1) + 1;
+    queueWaiter.notify();
+    std::unique_lock<std::mutex> lock(flushMutex);
+    flushCond.wait(lock, [this, ticket]() {
+        return flushCompleted.load() >= ticket;
+    });
+}
+
+Logger::Metrics Logger::metrics() const {
+    Metrics m;
+    m.uptime = std::chrono::steady_clock::now() - startTime;
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);  // 与回收互斥，已退出线程的计数不会丢也不会重复
+        m.dropped = reapedDropped;
+        for (size_t i = 0; i < Metrics::kLatencyBuckets; ++i) {
+            m.enqueueLatency[i] = reapedLatency[i];
+        }
+        for (auto& buf : buffers) {
+            m.queueDepth += buf->ring.size();
+            m.queueCapacity += buf->ring.capacity();
+            m.dropped += buf->dropped.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < Metrics::kLatencyBuckets; ++i) {
+                m.enqueueLatency[i] += buf->latency[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    for (uint64_t n : m.enqueueLatency) m.enqueued += n;
+    m.peakQueueDepth = std::max(peakQueueDepth.load(std::memory_order_relaxed), m.queueDepth);
+    m.messagesWritten = messagesWritten.load(std::memory_order_relaxed);
+    m.bytesWritten = bytesWritten.load(std::memory_order_relaxed);
+    m.batchesWritten = batchesWritten.load(std::memory_order_relaxed);
+    m.ioTime = std::chrono::nanoseconds(ioNanos.load(std::memory_order_relaxed));
+    return m;
+}
+
 void Logger::log(Level level, const std::string& message) {
     if (level < minLevel.load()) return;  // 如果日志级别低于设定的最低级别，则不记录日志
 
-    std::string formatted = formatMessage(level, message);
-    {
-        std::lock_guard<std::mutex> lock(queueMutex);  // 加锁
-        logQueue.push(formatted);  // 将格式化后的日志添加到队列中
+    LogRecord rec;
+    rec.init(level, nullptr);
+    rec.text = message;  // 格式化留给后台线程
+    submit(std::move(rec));
+}
+
+void Logger::submit(LogRecord&& rec) {
+    ProducerBuffer& buf = localBuffer();
+    int64_t since = rec.timestamp;  // 入队耗时从 init() 取时间戳算起
+    if (!buf.ring.tryPush(std::move(rec))) {
+        queueWaiter.notify();  // 缓冲已满，确保后台线程醒着
+        switch (overflowPolicy.load(std::memory_order_relaxed)) {
+            case DROP_NEWEST:
+                buf.dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            case DROP_OLDEST:
+                while (!buf.ring.tryPush(std::move(rec))) {
+                    if (buf.ring.dropOldest()) {
+                        buf.dropped.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+                break;
+            case DROP_BELOW_LEVEL:
+                if (rec.level < dropBelowLevel.load(std::memory_order_relaxed)) {
+                    buf.dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                [[fallthrough]];
+            case BLOCK:
+                while (!buf.ring.tryPush(std::move(rec))) {
+                    queueWaiter.notify();  // 确保后台线程醒着，再睡到它从本缓冲取走记录
+                    buf.spaceWaiter.wait([&buf]() { return buf.ring.size() < buf.ring.capacity(); });
+                }
+                break;
+        }
     }
-    queueCond.notify_one();  // 通知后台线程
+    recordLatency(buf, since);
+    queueWaiter.notify();  // 仅在后台线程睡眠时才真正唤醒
+}
+
+void Logger::recordLatency(ProducerBuffer& buf, int64_t since) {
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    uint64_t ns = now > since ? static_cast<uint64_t>(now - since) : 0;  // 系统时间回拨时记为 0
+    size_t bucket = std::min<size_t>(63 - __builtin_clzll(ns | 1), Metrics::kLatencyBuckets - 1);
+    auto& counter = buf.latency[bucket];
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);  // 单写者，无需原子加
+}
+
+Logger::ProducerBuffer& Logger::localBuffer() {
+    // 线程退出时只做标记，缓冲由 buffers 持有，后台线程排空后再回收
+    struct Handle {
+        std::shared_ptr<ProducerBuffer> buf;
+        ~Handle() {
+            if (buf) buf->retired.store(true, std::memory_order_release);
+        }
+    };
+    thread_local Handle handle;
+
+    if (!handle.buf) {
+        handle.buf = std::make_shared<ProducerBuffer>(bufferCapacity.load());
+        {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            buffers.push_back(handle.buf);
+        }
+        buffersVersion.fetch_add(1, std::memory_order_release);
+    }
+    return *handle.buf;
 }
 
 void Logger::processQueue() {
     while (true) {
-        std::unique_lock<std::mutex> lock(queueMutex);
-        queueCond.wait(lock, [this]() {
-            return !logQueue.empty() || exitFlag;
-        });
-
-        while (!logQueue.empty()) {
-            logfile << logQueue.front() << std::endl;  // 将队列中的日志写入文件
-            logQueue.pop();  // 从队列中移除
+        long timeoutMs = nextTimeoutMs();
+        if (timeoutMs != 0) {
+            queueWaiter.wait([this]() {  // 先自旋，再 futex 睡眠
+                return hasPending() || exitFlag;
+            }, timeoutMs);
+        }
+        applyPendingConfig();
+        refreshBuffers();
+        sampleQueueDepth();
+
+        for (auto& buf : activeBuffers) {  // 轮询各线程的缓冲
+            drainBuffer(*buf, kDrainBatch);
+        }
+
+        if (!writeBuffer.empty() &&
+            std::chrono::steady_clock::now() - batchStart >= config.flush.maxDelay) {
+            flushBuffer();
         }
 
-        if (exitFlag && logQueue.empty()) {
-            break;  // 如果退出标志为真并且队列为空，则退出线程
+        reportDrops(false);
+        completeFlush();
+        reapRetiredBuffers();
+
+        if (exitFlag && !hasPending()) {
+            reportDrops(true);
+            flushBuffer();
+            break;  // 如果退出标志为真并且所有缓冲为空，则退出线程
+        }
+    }
+}
+
+bool Logger::hasPending() {
+    if (buffersVersion.load(std::memory_order_relaxed) != seenBuffersVersion ||
+        configVersion.load(std::memory_order_relaxed) != appliedVersion ||
+        flushRequested.load(std::memory_order_relaxed) != flushCompleted.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    for (auto& buf : activeBuffers) {
+        if (!buf->ring.empty()) return true;
+    }
+    return false;
+}
+
+void Logger::refreshBuffers() {
+    unsigned version = buffersVersion.load(std::memory_order_acquire);
+    if (version == seenBuffersVersion) return;
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    activeBuffers = buffers;
+    seenBuffersVersion = version;
+}
+
+size_t Logger::drainBuffer(ProducerBuffer& buf, size_t maxCount) {
+    size_t count = 0;
+    while (count < maxCount && buf.ring.tryPop(record)) {
+        writeRecord(record);
+        ++count;
+    }
+    if (count > 0) buf.spaceWaiter.notify();  // 只有生产者在 BLOCK 下睡着时才真正唤醒
+    return count;
+}
+
+void Logger::writeRecord(const LogRecord& rec) {
+    if (writeBuffer.empty()) {
+        batchStart = std::chrono::steady_clock::now();
+    }
+    ++batchMessages;
+    if (config.format == BINARY) {
+        encoder.encode(rec, writeBuffer);
+    } else {
+        formatMessage(rec, writeBuffer);  // 直接格式化进批量缓冲
+        writeBuffer += '\n';
+    }
+    if (writeBuffer.size() >= config.flush.maxBytes ||
+        (config.flush.flushOnError && rec.level >= ERROR)) {
+        flushBuffer();
+    }
+}
+
+long Logger::nextTimeoutMs() {
+    // 缓冲为空且没有未上报的丢弃时无限等待，否则最多等到最近的截止时间
+    auto now = std::chrono::steady_clock::now();
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    if (!writeBuffer.empty()) {
+        deadline = batchStart + config.flush.maxDelay;
+    }
+    if (droppedTotal() != reportedDrops) {
+        deadline = std::min(deadline, lastDropReport + config.dropReportInterval);
+    }
+    if (deadline == std::chrono::steady_clock::time_point::max()) return -1;
+    // 向上取整：不足 1 ms 时截断成 0 会让后台线程空转到截止时间
+    auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
+    return left > 0 ? left : 0;
+}
+
+uint64_t Logger::droppedTotal() const {
+    uint64_t total = reapedDropped;
+    for (auto& buf : activeBuffers) {
+        total += buf->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void Logger::reportDrops(bool force) {
+    auto now = std::chrono::steady_clock::now();
+    if (!force && now - lastDropReport < config.dropReportInterval) return;
+    lastDropReport = now;
+
+    uint64_t total = droppedTotal();
+    if (total == reportedDrops) return;
+    LogRecord rec;
+    rec.init(WARNING, "Logger: dropped {} messages because buffers were full ({} in total)");
+    rec.capture(total - reportedDrops);
+    rec.capture(total);
+    writeRecord(rec);
+    reportedDrops = total;
+}
+
+void Logger::completeFlush() {
+    uint64_t requested = flushRequested.load();
+    if (requested == flushCompleted.load(std::memory_order_relaxed)) return;
+
+    // 只取走屏障之前已发布的记录，生产者持续写入时也不会无限排空下去
+    refreshBuffers();
+    for (auto& buf : activeBuffers) {
+        drainBuffer(*buf, buf->ring.size());
+    }
+    reportDrops(true);
+    flushBuffer();
+    if (sink) {
+        auto begin = std::chrono::steady_clock::now();
+        sink->sync();
+        addIoTime(begin);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(flushMutex);
+        flushCompleted.store(requested);
+    }
+    flushCond.notify_all();
+}
+
+void Logger::reapRetiredBuffers() {
+    auto dead = [](const std::shared_ptr<ProducerBuffer>& buf) {
+        return buf->retired.load(std::memory_order_acquire) && buf->ring.empty();
+    };
+    if (std::none_of(activeBuffers.begin(), activeBuffers.end(), dead)) return;
+
+    std::lock_guard<std::mutex> lock(buffersMutex);  // 与线程注册互斥
+    // dead 只求值一次：生产者线程随时可能退出，两次求值之间变成 dead 的缓冲会被删掉却没有计入统计
+    auto mid = std::stable_partition(buffers.begin(), buffers.end(),
+                                     [&dead](const std::shared_ptr<ProducerBuffer>& buf) { return !dead(buf); });
+    for (auto it = mid; it != buffers.end(); ++it) {
+        reapedDropped += (*it)->dropped.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < Metrics::kLatencyBuckets; ++i) {
+            reapedLatency[i] += (*it)->latency[i].load(std::memory_order_relaxed);
         }
     }
+    buffers.erase(mid, buffers.end());
+    activeBuffers = buffers;
+}
+
+void Logger::applyPendingConfig() {
+    unsigned version = configVersion.load(std::memory_order_acquire);
+    if (version == appliedVersion) return;
+
+    Config next;
+    {
+        std::lock_guard<std::mutex> lock(configMutex);
+        next = pendingConfig;
+    }
+    appliedVersion = version;
+
+    bool sinkChanged = next.path != config.path || next.sink != config.sink ||
+                       next.segmentBytes != config.segmentBytes ||
+                       next.rotateInterval != config.rotateInterval;
+    if (sinkChanged || next.format != config.format) {
+        flushBuffer();  // 旧输出端、旧格式的日志先写完
+        encoder.reset();  // 新的二进制流重新写流头和格式串表
+    }
+    if (sinkChanged) {
+        sink.reset();  // 新的输出端在下一次写出时创建
+    }
+    config = next;
+    writeBuffer.reserve(config.flush.maxBytes + 4096);
+}
+
+void Logger::flushBuffer() {
+    if (!writeBuffer.empty()) {
+        if (!sink) sink = makeSink(config);  // 第一次写出时才打开，configure() 之前不会创建默认文件
+        auto begin = std::chrono::steady_clock::now();
+        sink->write(writeBuffer.data(), writeBuffer.size());
+        addIoTime(begin);
+        messagesWritten.store(messagesWritten.load(std::memory_order_relaxed) + batchMessages,
+                              std::memory_order_relaxed);
+        bytesWritten.store(bytesWritten.load(std::memory_order_relaxed) + writeBuffer.size(),
+                           std::memory_order_relaxed);
+        batchesWritten.store(batchesWritten.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    writeBuffer.clear();
+    batchMessages = 0;
+}
+
+void Logger::sampleQueueDepth() {
+    // 每轮取数前积压最多，在这里采样
+    size_t depth = 0;
+    for (auto& buf : activeBuffers) {
+        depth += buf->ring.size();
+    }
+    if (depth > peakQueueDepth.load(std::memory_order_relaxed)) {
+        peakQueueDepth.store(depth, std::memory_order_relaxed);
+    }
+}
+
+void Logger::addIoTime(std::chrono::steady_clock::time_point since) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since);
+    ioNanos.store(ioNanos.load(std::memory_order_relaxed) + ns.count(), std::memory_order_relaxed);
+}
+
+std::unique_ptr<LogSink> Logger::makeSink(const Config& config) {
+    if (config.sink == MMAP_SINK) {
+        return std::make_unique<MmapSink>(config.path, config.segmentBytes, config.rotateInterval);
+    }
+    return std::make_unique<FileSink>(config.path);
 }
 
-std::string Logger::formatMessage(Level level, const std::string& message) {
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    char buf[26];
-    ctime_r(&time, buf);
-    buf[24] = '\0';  // 移除换行符
+void Logger::formatMessage(const LogRecord& rec, std::string& out) {
+    time_t sec = static_cast<time_t>(rec.timestamp / 1000000000);
+    if (sec != cachedSecond) {
+        ctime_r(&sec, cachedTime);
+        cachedTime[24] = '\0';  // 移除换行符
+        cachedSecond = sec;
+    }
+
+    out += '[';
+    out += cachedTime;
+    out += "] [";
+    out += levelToString(static_cast<Level>(rec.level));
+    out += "] ";
 
-    return "[" + std::string(buf) + "] [" + levelToString(level) + "] " + message;
+    rec.appendBody(out);
 }
 
-std::string Logger::levelToString(Level level) {
+const char* Logger::levelToString(Level level) {
     switch (level) {
         case DEBUG:   return "DEBUG";
         case INFO:    return "INFO";
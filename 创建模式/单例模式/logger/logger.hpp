@@ -1,20 +1,118 @@
 #pragma once
 #include <string>
-#include <fstream>
-#include <mutex>
-#include <queue>
+#include <type_traits>
+#include <memory>
+#include <vector>
 #include <thread>
-#include <condition_variable>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <ctime>
+#include "lockfree.hpp"
+#include "log_record.hpp"
+#include "log_binary.hpp"
+
+class LogSink;
 
 class Logger {
 public:
     enum Level { DEBUG, INFO, WARNING, ERROR };
 
+    // 刷盘策略：满足任一条件时，后台线程把攒下的整批日志一次 write 出去
+    struct FlushPolicy {
+        size_t maxBytes = 64 * 1024;              // 缓冲达到该字节数
+        std::chrono::milliseconds maxDelay{100};  // 缓冲中最早的日志滞留超过该时间
+        bool flushOnError = true;                 // 遇到 ERROR 级别日志
+    };
+
+    enum SinkType { FILE_SINK, MMAP_SINK };
+
+    // TEXT 为 "[时间] [级别] 消息" 文本；BINARY 为紧凑二进制记录（格式见 log_binary.hpp），用 log-decoder 还原为文本
+    enum OutputFormat { TEXT, BINARY };
+
+    // 线程缓冲写满时的处理方式
+    enum OverflowPolicy {
+        BLOCK,             // 等待后台线程腾出空间
+        DROP_NEWEST,       // 丢弃当前这条
+        DROP_OLDEST,       // 丢弃缓冲中最旧的一条
+        DROP_BELOW_LEVEL   // 低于 dropBelow 的丢弃，其余等待
+    };
+
+    // 日志输出配置
+    struct Config {
+        std::string path = "app.log";             // 文件路径；MMAP_SINK 下为分段文件前缀 <path>.<序号>
+        SinkType sink = FILE_SINK;
+        OutputFormat format = TEXT;               // 切换格式时请同时更换 path，避免同一文件混杂两种格式
+        size_t segmentBytes = 64 * 1024 * 1024;   // MMAP_SINK：每段预分配大小，写满即滚动
+        std::chrono::seconds rotateInterval{0};   // MMAP_SINK：按时间滚动，0 表示不按时间滚动
+        FlushPolicy flush;
+        size_t bufferCapacity = 1024;             // 每个线程缓冲的槽位数，对之后首次写日志的线程生效
+        OverflowPolicy overflow = BLOCK;          // 缓冲写满时的处理方式
+        Level dropBelow = WARNING;                // DROP_BELOW_LEVEL 的级别阈值
+        std::chrono::seconds dropReportInterval{10};  // 丢弃条数写回日志的周期
+    };
+
+    // 运行指标快照：计数器自 Logger 创建起累计，速率（条/秒、批/秒）由两次快照相减除以 uptime 之差得到
+    struct Metrics {
+        static constexpr size_t kLatencyBuckets = 32;
+
+        std::chrono::nanoseconds uptime{0};   // 快照时距 Logger 创建的时间
+        size_t queueDepth = 0;                // 各线程缓冲中尚未被后台线程取走的条数
+        size_t peakQueueDepth = 0;            // 后台线程每轮取数前观察到的最大积压
+        size_t queueCapacity = 0;             // 当前各线程缓冲的槽位总数
+        uint64_t enqueued = 0;                // 成功入队的条数
+        uint64_t dropped = 0;                 // 因缓冲写满而丢弃的条数
+        uint64_t enqueueLatency[kLatencyBuckets] = {};  // 第 i 格：入队耗时在 [2^i, 2^(i+1)) 纳秒内的条数
+        uint64_t messagesWritten = 0;         // 已交给输出端的条数，含 Logger 自己的丢弃报告
+        uint64_t bytesWritten = 0;
+        uint64_t batchesWritten = 0;          // 批量 write 的次数
+        std::chrono::nanoseconds ioTime{0};   // 花在输出端 write / sync 上的时间
+
+        // 入队耗时的 p 分位（0~1），返回所在格的上界（纳秒）
+        uint64_t enqueueLatencyPercentile(double p) const {
+            if (enqueued == 0) return 0;
+            uint64_t rank = static_cast<uint64_t>(p * enqueued);
+            uint64_t seen = 0;
+            for (size_t i = 0; i < kLatencyBuckets; ++i) {
+                seen += enqueueLatency[i];
+                if (seen > rank || seen == enqueued) return uint64_t(1) << (i + 1);
+            }
+            return uint64_t(1) << kLatencyBuckets;
+        }
+    };
+
     static Logger& getInstance();  // 获取单例实例
 
     void setLevel(Level level);    // 设置日志级别
+    void setFlushPolicy(const FlushPolicy& policy);  // 设置刷盘策略
+    void configure(const Config& config);  // 切换输出配置，由后台线程在两批日志之间生效
+    void flush();  // 屏障：返回时，调用前已入队的所有日志都已写入并落盘
     void log(Level level, const std::string& message);  // 记录日志
+    bool shouldLog(Level level) const { return level >= minLevel.load(std::memory_order_relaxed); }
+    Metrics metrics() const;  // 取一份运行指标快照，任意线程可调用，不阻塞日志路径
+
+    // 惰性构造：只有通过运行时级别检查后才调用 makeMessage()，例如
+    // log(DEBUG, [&] { return "state = " + dump(state); })
+    template<typename F, typename = std::enable_if_t<std::is_invocable_r_v<std::string, F&>>>
+    void log(Level level, F&& makeMessage) {
+        if (!shouldLog(level)) return;
+        LogRecord rec;
+        rec.init(level, nullptr);
+        rec.text = makeMessage();
+        submit(std::move(rec));
+    }
+
+    // 延迟格式化：只保存参数原始值，由后台线程把 "{}" 依次替换为参数
+    // fmt 必须是字符串字面量，例如 logf(INFO, "user {} login from {}", id, ip)
+    template<typename... Args>
+    void logf(Level level, const char* fmt, const Args&... args) {
+        if (!shouldLog(level)) return;
+        LogRecord rec;
+        rec.init(level, fmt);
+        (rec.capture(args), ...);
+        submit(std::move(rec));
+    }
 
 private:
     Logger();  // 构造函数
@@ -23,15 +121,115 @@ private:
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
 
+    // 每个生产者线程独占的缓冲，线程第一次写日志时注册
+    struct ProducerBuffer {
+        explicit ProducerBuffer(size_t capacity) : ring(capacity) {}
+        SpscRing<LogRecord> ring;
+        std::atomic<bool> retired{false};  // 所属线程已退出，排空后回收
+        std::atomic<uint64_t> dropped{0};  // 因缓冲写满而丢弃的条数
+        SpinFutexWaiter spaceWaiter{0, 8};  // BLOCK 时所属线程在此等后台线程腾出空间；要等的后台线程可能与它共用一个核，不忙等
+        // 入队耗时直方图，只有所属线程写入，与后台线程读的字段分开缓存行
+        alignas(64) std::atomic<uint64_t> latency[Metrics::kLatencyBuckets] = {};
+    };
+
+    void submit(LogRecord&& rec);  // 将日志记录放入本线程的缓冲
+    static void recordLatency(ProducerBuffer& buf, int64_t since);  // 记一次入队耗时
+    ProducerBuffer& localBuffer();  // 取得（必要时注册）本线程的缓冲
     void processQueue();  // 后台线程处理日志队列
-    std::string formatMessage(Level level, const std::string& message);  // 格式化日志信息
-    std::string levelToString(Level level);  // 将日志级别转换为字符串
+    bool hasPending();  // 是否有待后台线程处理的工作
+    void refreshBuffers();  // 同步新注册的缓冲
+    size_t drainBuffer(ProducerBuffer& buf, size_t maxCount);  // 从一个缓冲取出至多 maxCount 条
+    void writeRecord(const LogRecord& rec);  // 格式化进批量缓冲，必要时写出
+    void completeFlush();  // 处理 flush() 请求
+    void reapRetiredBuffers();  // 回收已退出线程的空缓冲
+    uint64_t droppedTotal() const;  // 累计丢弃条数（后台线程）
+    void reportDrops(bool force);  // 周期性地把丢弃条数写进日志
+    long nextTimeoutMs();  // 后台线程本轮最多睡多久
+    void applyPendingConfig();  // 后台线程取用最新的配置
+    void flushBuffer();  // 将批量缓冲写入输出端
+    void sampleQueueDepth();  // 更新积压峰值
+    void addIoTime(std::chrono::steady_clock::time_point since);  // 累计输出端耗时
+    static std::unique_ptr<LogSink> makeSink(const Config& config);  // 按配置创建输出端
+    void formatMessage(const LogRecord& rec, std::string& out);  // 格式化日志信息（后台线程）
+    static const char* levelToString(Level level);  // 将日志级别转换为字符串
+
+    static constexpr size_t kDrainBatch = 64;  // 轮询时每个缓冲一次最多取出的条数
 
-    std::ofstream logfile;  // 日志文件流
-    std::mutex queueMutex;  // 锁
-    std::condition_variable queueCond;  // 条件变量
-    std::queue<std::string> logQueue;  // 日志队列
+    mutable std::mutex buffersMutex;  // 仅在线程注册/回收缓冲及取指标快照时加锁
+    std::vector<std::shared_ptr<ProducerBuffer>> buffers;  // 所有生产者缓冲
+    std::atomic<unsigned> buffersVersion{0};  // buffers 的版本号
+    SpinFutexWaiter queueWaiter;  // 后台线程的等待器
+    std::mutex flushMutex;  // 仅用于 flush() 调用者等待
+    std::condition_variable flushCond;
+    std::atomic<uint64_t> flushRequested{0};  // flush() 请求序号
+    std::atomic<uint64_t> flushCompleted{0};  // 已完成的 flush 请求序号
     std::thread workerThread;  // 后台线程
-    bool exitFlag;  // 退出标志
+    std::atomic<bool> exitFlag;  // 退出标志
     std::atomic<Level> minLevel;  // 最低日志级别
+    std::atomic<size_t> bufferCapacity;  // 以下三项生产者直接读取，configure 时立即生效
+    std::atomic<OverflowPolicy> overflowPolicy;
+    std::atomic<Level> dropBelowLevel;
+    std::mutex configMutex;  // 仅保护 pendingConfig，不在日志路径上
+    Config pendingConfig;  // configure / setFlushPolicy 写入
+    std::atomic<unsigned> configVersion{0};  // pendingConfig 的版本号
+    const std::chrono::steady_clock::time_point startTime;
+    // 以下指标只由后台线程写入
+    std::atomic<size_t> peakQueueDepth{0};
+    std::atomic<uint64_t> messagesWritten{0};
+    std::atomic<uint64_t> bytesWritten{0};
+    std::atomic<uint64_t> batchesWritten{0};
+    std::atomic<int64_t> ioNanos{0};
+    // 以下成员仅后台线程访问
+    std::vector<std::shared_ptr<ProducerBuffer>> activeBuffers;  // buffers 的本地快照
+    unsigned seenBuffersVersion = 0;
+    LogRecord record;  // 出队用的临时记录
+    uint64_t reapedDropped = 0;  // 已回收缓冲的丢弃条数，与下一项在 buffersMutex 下更新
+    uint64_t reapedLatency[Metrics::kLatencyBuckets] = {};  // 已回收缓冲的入队耗时直方图
+    uint64_t reportedDrops = 0;  // 已写进日志的丢弃条数
+    std::chrono::steady_clock::time_point lastDropReport;
+    Config config;  // 当前生效的配置
+    unsigned appliedVersion = 0;
+    std::unique_ptr<LogSink> sink;  // 日志输出端，第一次写出时创建
+    std::string writeBuffer;  // 批量写缓冲
+    size_t batchMessages = 0;  // 批量缓冲中的条数
+    std::chrono::steady_clock::time_point batchStart;  // 缓冲中第一条日志的入缓冲时间
+    logbin::Encoder encoder;  // BINARY 格式的编码状态
+    time_t cachedSecond = -1;  // 同一秒内复用 ctime_r 的结果
+    char cachedTime[26];
 };
+
+// ------------------- 日志宏 --------------------
+// 编译期最低级别：0=DEBUG 1=INFO 2=WARNING 3=ERROR，低于该级别的宏展开为空语句，参数也不会被求值。
+// 默认 Release（定义了 NDEBUG）去掉 DEBUG，可在编译命令中用 -DLOGGER_COMPILE_LEVEL=N 覆盖。
+#ifndef LOGGER_COMPILE_LEVEL
+#ifdef NDEBUG
+#define LOGGER_COMPILE_LEVEL 1
+#else
+#define LOGGER_COMPILE_LEVEL 0
+#endif
+#endif
+
+// 用法与 logf 相同：LOG_INFO("user {} login", id)
+#if LOGGER_COMPILE_LEVEL <= 0
+#define LOG_DEBUG(...) Logger::getInstance().logf(Logger::DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOGGER_COMPILE_LEVEL <= 1
+#define LOG_INFO(...) Logger::getInstance().logf(Logger::INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOGGER_COMPILE_LEVEL <= 2
+#define LOG_WARNING(...) Logger::getInstance().logf(Logger::WARNING, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) ((void)0)
+#endif
+
+#if LOGGER_COMPILE_LEVEL <= 3
+#define LOG_ERROR(...) Logger::getInstance().logf(Logger::ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
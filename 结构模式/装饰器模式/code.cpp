@@ -1,7 +1,14 @@
-
-
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <new>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 class Beverage {
 public:
@@ -23,6 +30,13 @@ public:
 };
 
 
+// 调料的名称和附加费用，装饰器和 BeverageBuilder 共用
+struct Condiment {
+    std::string_view name;
+    double price;
+};
+
+
 // 装饰器类，继承自Beverage接口
 class CondimentDecorator : public Beverage {
 public:
@@ -32,49 +46,189 @@ public:
 
 class Milk : public CondimentDecorator {
 private:
-    Beverage* beverage;  // 被装饰的对象
+    std::unique_ptr<Beverage> beverage;  // 被装饰的对象，随装饰器一起释放
 
 public:
-    Milk(Beverage* bev) : beverage(bev) {}
+    static constexpr Condiment kCondiment{"Milk", 1.0};  // 牛奶的附加费用
+
+    explicit Milk(std::unique_ptr<Beverage> bev) : beverage(std::move(bev)) {}
 
     std::string getDescription() const override {
-        return beverage->getDescription() + ", Milk";  // 在原有描述上添加牛奶
+        return beverage->getDescription() + ", " + std::string(kCondiment.name);  // 在原有描述上添加牛奶
     }
 
     double cost() const override {
-        return beverage->cost() + 1.0;  // 牛奶的附加费用
+        return beverage->cost() + kCondiment.price;
     }
 };
 
 class Sugar : public CondimentDecorator {
 private:
-    Beverage* beverage;
+    std::unique_ptr<Beverage> beverage;
 
 public:
-    Sugar(Beverage* bev) : beverage(bev) {}
+    static constexpr Condiment kCondiment{"Sugar", 0.5};  // 糖的附加费用
+
+    explicit Sugar(std::unique_ptr<Beverage> bev) : beverage(std::move(bev)) {}
 
     std::string getDescription() const override {
-        return beverage->getDescription() + ", Sugar";  // 在原有描述上添加糖
+        return beverage->getDescription() + ", " + std::string(kCondiment.name);  // 在原有描述上添加糖
     }
 
     double cost() const override {
-        return beverage->cost() + 0.5;  // 糖的附加费用
+        return beverage->cost() + kCondiment.price;
     }
 };
 
 
+// ------------------- 扁平化的装饰链 --------------------
+// 逐层装饰的链每次 cost() / getDescription() 都要递归到底，描述在每一层重新拼接，链长为 n 时是 O(n²)。
+// BeverageBuilder 把整条链编译成 arena 里的一个对象：价格预先算好，描述一次拼好紧跟在对象后面，
+// 之后求值是 O(1) 且不再分配。
+
+// 顺序分配的内存池：只分配不单独释放，池销毁时整块归还。
+// 放在池里的对象不会被调用析构函数，所以不能持有需要释放的资源
+class Arena {
+public:
+    explicit Arena(size_t blockSize = 4096) : blockSize(blockSize) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t align) {
+        size_t offset = (used + align - 1) / align * align;
+        if (blocks.empty() || offset + size > capacity) {
+            capacity = std::max(blockSize, size + align);
+            blocks.push_back(std::make_unique<char[]>(capacity));
+            offset = (reinterpret_cast<uintptr_t>(blocks.back().get()) % align == 0) ? 0
+                     : align - reinterpret_cast<uintptr_t>(blocks.back().get()) % align;
+        }
+        used = offset + size;
+        return blocks.back().get() + offset;
+    }
+
+    size_t blockCount() const { return blocks.size(); }
+
+private:
+    size_t blockSize;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t capacity = 0;  // 当前块的大小
+    size_t used = 0;      // 当前块已用的字节
+};
+
+
+// 编译好的饮品：价格和描述在构造时确定
+class CompiledBeverage final : public Beverage {
+public:
+    CompiledBeverage(const char* desc, size_t length, double price) : desc(desc, length), price(price) {}
+
+    std::string getDescription() const override {
+        return std::string(desc);  // 接口要求返回 std::string；不想复制时用 description()
+    }
+
+    double cost() const override {
+        return price;
+    }
+
+    std::string_view description() const {
+        return desc;
+    }
+
+private:
+    std::string_view desc;  // 指向同一 arena 中紧跟对象的字符
+    double price;
+};
+
+
+// 用法：BeverageBuilder(arena, Coffee()).add(Milk::kCondiment).add(Sugar::kCondiment).build()
+// 调料按添加顺序排列，结果与逐层套上 Milk / Sugar 装饰器的描述和价格相同
+class BeverageBuilder {
+public:
+    BeverageBuilder(Arena& arena, const Beverage& base)
+        : arena(arena), baseDescription(base.getDescription()), basePrice(base.cost()) {}
+
+    BeverageBuilder& add(const Condiment& condiment, size_t times = 1) {
+        condiments.insert(condiments.end(), times, condiment);
+        return *this;
+    }
+
+    // 对象和描述放在 arena 中相邻的一块内存里，由 arena 负责释放
+    const CompiledBeverage* build() const {
+        size_t length = baseDescription.size();
+        double price = basePrice;
+        for (const Condiment& c : condiments) {
+            length += 2 + c.name.size();
+            price += c.price;  // 与逐层装饰的累加顺序相同，结果逐位一致
+        }
+
+        void* mem = arena.allocate(sizeof(CompiledBeverage) + length, alignof(CompiledBeverage));
+        char* text = static_cast<char*>(mem) + sizeof(CompiledBeverage);
+        char* p = text;
+        p = std::copy(baseDescription.begin(), baseDescription.end(), p);
+        for (const Condiment& c : condiments) {
+            *p++ = ',';
+            *p++ = ' ';
+            p = std::copy(c.name.begin(), c.name.end(), p);
+        }
+        return new (mem) CompiledBeverage(text, length, price);
+    }
+
+private:
+    Arena& arena;
+    std::string baseDescription;
+    double basePrice;
+    std::vector<Condiment> condiments;
+};
+
+
 int main() {
     // 创建一个咖啡对象
-    Beverage* beverage = new Coffee();
+    std::unique_ptr<Beverage> beverage = std::make_unique<Coffee>();
 
-    // 使用装饰器为咖啡添加牛奶和糖
-    beverage = new Milk(beverage);
-    beverage = new Sugar(beverage);
+    // 使用装饰器为咖啡添加牛奶和糖；每层装饰器拥有被装饰的对象
+    beverage = std::make_unique<Milk>(std::move(beverage));
+    beverage = std::make_unique<Sugar>(std::move(beverage));
 
     // 输出咖啡的描述和价格
     std::cout << beverage->getDescription() << " costs " << beverage->cost() << std::endl;
 
-    // 释放资源
-    delete beverage;
+    // 同样的订单编译成一个对象
+    Arena arena;
+    const CompiledBeverage* compiled =
+        BeverageBuilder(arena, Coffee()).add(Milk::kCondiment).add(Sugar::kCondiment).build();
+    std::cout << compiled->description() << " costs " << compiled->cost() << std::endl;
+
+    // 50 种调料的订单：逐层装饰与编译后的求值耗时对比
+    const size_t kCondiments = 50, kRounds = 10000;
+    std::unique_ptr<Beverage> chain = std::make_unique<Coffee>();
+    BeverageBuilder builder(arena, Coffee());
+    for (size_t i = 0; i < kCondiments; ++i) {
+        if (i % 2 == 0) {
+            chain = std::make_unique<Milk>(std::move(chain));
+            builder.add(Milk::kCondiment);
+        } else {
+            chain = std::make_unique<Sugar>(std::move(chain));
+            builder.add(Sugar::kCondiment);
+        }
+    }
+    const CompiledBeverage* order = builder.build();
+
+    auto time = [&](auto&& evaluate) {
+        size_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < kRounds; ++r) sink += evaluate();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return std::make_pair(ms, sink);
+    };
+    auto chained = time([&] { return chain->getDescription().size() + static_cast<size_t>(chain->cost()); });
+    // 经 volatile 指针读取，编译器每轮都要重新求值，不能把整个循环当作常量提到外面
+    const CompiledBeverage* volatile opaque = order;
+    auto flat = time([&] { return opaque->description().size() + static_cast<size_t>(opaque->cost()); });
+
+    bool same = chain->getDescription() == order->description() && chain->cost() == order->cost();
+    same = same && chained.second == flat.second;
+    std::cout << kCondiments << " condiments, " << kRounds << " evaluations: chained " << chained.first
+              << " ms, compiled " << flat.first << " ms, results " << (same ? "match" : "DIFFER")
+              << ", arena blocks = " << arena.blockCount() << std::endl;
     return 0;
 }
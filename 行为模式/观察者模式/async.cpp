@@ -1,4 +1,5 @@
 
+#include <fstream>
 #include <iostream>
 #include <vector>
 #include <queue>
@@ -6,182 +7,751 @@
 #include <mutex>
 #include <condition_variable>
 #include <memory>
+#include <algorithm>
 #include <atomic>
 #include <chrono>
-
-using Matrix = std::vector<std::vector<double>>;
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <utility>
+#include "broadcast_ring.hpp"
+#include "delta.hpp"
+#include "executor.hpp"
+#include "fill.hpp"
+#include "mapped_matrix.hpp"
+#include "matrix.hpp"
+#include "matrix_pool.hpp"
+#include "reduce.hpp"
+#include "trace.hpp"
 
 // ------------------- 线程安全队列 --------------------
+// 多生产者多消费者。close() 之后不再接受新元素，等待中的消费者被唤醒，取完剩余元素后各 pop 返回 false。
 template<typename T>
 class ThreadSafeQueue {
     std::queue<T> queue;
     std::mutex mtx;
     std::condition_variable cv;
+    bool closed = false;
 
 public:
-    void push(const T& val) {
+    // 队列已关闭时丢弃 val 并返回 false
+    bool push(const T& val) {
+        return emplace(val);
+    }
+
+    bool push(T&& val) {
+        return emplace(std::move(val));
+    }
+
+    // 等到有元素或队列关闭；关闭且已取空时返回 false
+    bool wait_and_pop(T& val) {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [this] { return !queue.empty() || closed; });
+        return popLocked(val);
+    }
+
+    // 最多等 timeout；超时、或关闭且已取空时返回 false
+    template<typename Rep, typename Period>
+    bool wait_for(T& val, const std::chrono::duration<Rep, Period>& timeout) {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait_for(lock, timeout, [this] { return !queue.empty() || closed; });
+        return popLocked(val);
+    }
+
+    template<typename Clock, typename Duration>
+    bool wait_until(T& val, const std::chrono::time_point<Clock, Duration>& deadline) {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait_until(lock, deadline, [this] { return !queue.empty() || closed; });
+        return popLocked(val);
+    }
+
+    // 队列为空时立即返回 false
+    bool try_pop(T& val) {
+        std::lock_guard<std::mutex> lock(mtx);
+        return popLocked(val);
+    }
+
+    // 等到有元素或队列关闭，然后一次加锁取出最多 max 个追加到 out；返回取出的个数，0 表示已关闭且取空
+    size_t pop_bulk(std::vector<T>& out, size_t max) {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [this] { return !queue.empty() || closed; });
+        return popBulkLocked(out, max);
+    }
+
+    // 不等待的 pop_bulk
+    size_t try_pop_bulk(std::vector<T>& out, size_t max) {
+        std::lock_guard<std::mutex> lock(mtx);
+        return popBulkLocked(out, max);
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            closed = true;
+        }
+        cv.notify_all();
+    }
+
+    bool empty() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return queue.empty();
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return queue.size();
+    }
+
+private:
+    template<typename U>
+    bool emplace(U&& val) {
         {
             std::lock_guard<std::mutex> lock(mtx);
-            queue.push(val);
+            if (closed) return false;
+            queue.push(std::forward<U>(val));
         }
         cv.notify_one();
+        return true;
     }
 
-    T wait_and_pop() {
-        std::unique_lock<std::mutex> lock(mtx);
-        cv.wait(lock, [this] { return !queue.empty(); });
-        T val = queue.front();
+    bool popLocked(T& val) {
+        if (queue.empty()) return false;
+        val = std::move(queue.front());
         queue.pop();
-        return val;
+        return true;
     }
+
+    size_t popBulkLocked(std::vector<T>& out, size_t max) {
+        size_t n = 0;
+        for (; n < max && !queue.empty(); ++n) {
+            out.push_back(std::move(queue.front()));
+            queue.pop();
+        }
+        return n;
+    }
+};
+
+// 广播环上的一帧：完整矩阵（关键帧）、相对上一版本的增量或者映射在文件上的大矩阵，加上追踪用的序号和时间戳
+// （Tracer::now()，未开启追踪时为 0）
+struct MatrixFrame {
+    std::shared_ptr<Matrix> matrix;            // 关键帧
+    std::shared_ptr<const MatrixDelta> delta;  // 增量
+    std::shared_ptr<const MappedMatrix> mapped; // 文件映射的矩阵；三者有且只有一个
+    TileGrid grid;                             // 关键帧的分块方式，来自 VersionedMatrix 时才有
+    uint64_t version = 0;                      // 关键帧的版本
+    uint64_t seq = 0;
+    int64_t generated = 0; // 填充完成
+    int64_t enqueued = 0;  // 进入观察者的队列：BOUNDED_BLOCK 即发布到环上，其余模式是 notify() 取走的时刻
 };
 
+using MatrixRing = BroadcastRing<MatrixFrame>;
+
 // ------------------- 抽象观察者 --------------------
+// 矩阵只在广播环上发布一次，观察者各自按自己的进度从环上读取
 class IMatrixObserver {
 public:
-    virtual void submitMatrix(std::shared_ptr<Matrix> mat) = 0;
+    virtual void attach(MatrixRing& ring) = 0; // 由 MatrixGenerator::addObserver 在生产者线程调用
+    virtual void notify() = 0;                 // 环上有新矩阵，不携带数据
     virtual void stop() = 0;
     virtual ~IMatrixObserver() = default;
 };
 
-// ------------------- 日志系统 --------------------
-class LoggerSystem : public IMatrixObserver {
-    ThreadSafeQueue<std::shared_ptr<Matrix>> queue;
+// 观察者跟不上生产者时的投递方式
+enum class Delivery {
+    QUEUE,          // 每个矩阵都处理：生产者把矩阵转入观察者自己的无界队列，从不等待
+    BOUNDED_BLOCK,  // 每个矩阵都处理：观察者直接从环上读，落后 limit 个后生产者等待
+    CONFLATE        // 只处理最新的：版本化矩阵的关键帧只保留最后一个，其后的增量合并为一个；
+                    // 其他矩阵（普通矩阵、文件映射的矩阵）也只保留最后一个，两者互不替换
+};
+
+struct DeliveryPolicy {
+    Delivery mode = Delivery::BOUNDED_BLOCK;
+    size_t limit = 0; // BOUNDED_BLOCK 时最多落后的矩阵数，0 表示广播环容量
+};
+
+// ------------------- 线程池上的异步观察者 --------------------
+// 观察者不再各占一个线程：每个观察者是广播环的一个消费者，有新矩阵时向共享线程池投递一个排空任务。
+// 同一观察者任何时刻最多只有一个排空任务在执行，因此它看到的矩阵顺序与发布顺序一致；
+// 线程数由线程池决定，与观察者数量无关。
+// QUEUE 和 CONFLATE 模式下，notify() 在生产者线程里立即把矩阵从环上取走，观察者不会拦住生产者；
+// 内存占用分别由队列长度（无界）和最多三个待处理帧（关键帧、合并后的增量、其他矩阵）决定。
+// 派生类析构前必须先调用 stop()，保证不会再有回调进入正在析构的对象；stop() 也必须在广播环销毁之前调用，
+// 并且不能与 MatrixGenerator::generateMatrix 并发。
+class AsyncObserver : public IMatrixObserver {
+    MatrixRing::Consumer* consumer = nullptr;
+    WorkStealingExecutor& executor;
+    const DeliveryPolicy policy;
+    const size_t batch; // 每次排空最多处理的条数，之后让出线程给其他观察者
+    ThreadSafeQueue<MatrixFrame> mailbox; // QUEUE
+    std::vector<MatrixFrame> inbox;       // QUEUE：从 mailbox 一次取出的一批，只由排空任务访问
+    std::mutex latestMtx;                 // CONFLATE：保护 latest
+    std::vector<MatrixFrame> latest;      // CONFLATE：最多一个关键帧、一个增量和一个其他矩阵
+    std::atomic<uint64_t> conflated{0};   // CONFLATE：被替换或合并掉的帧数
+    Tracer* tracer = nullptr;
+    size_t track = 0;
+    std::atomic<bool> scheduled{false}; // 已有排空任务在池中或正在执行
     std::atomic<bool> running{true};
-    std::thread worker;
+    std::mutex idleMtx;
+    std::condition_variable idleCv;
 
 public:
-    LoggerSystem() {
-        worker = std::thread([this]() {
-            while (running) {
-                auto mat = queue.wait_and_pop();
-                if (mat->empty()) continue; // 忽略 dummy 空矩阵
-
-                std::cout << "[Logger] Received matrix: "
-                        << mat->size() << "x" << (*mat)[0].size() << "\n";
-            }
-        });
+    explicit AsyncObserver(WorkStealingExecutor& executor, DeliveryPolicy policy = {}, size_t batch = 16)
+        : executor(executor), policy(policy), batch(batch) {
+        if (policy.mode == Delivery::QUEUE) inbox.reserve(batch);
+        if (policy.mode == Delivery::CONFLATE) latest.reserve(3);
+    }
+
+    ~AsyncObserver() override {
+        stop();
+    }
 
+    void attach(MatrixRing& ring) override {
+        consumer = &ring.addConsumer(policy.mode == Delivery::BOUNDED_BLOCK ? policy.limit : 0);
     }
 
-    void submitMatrix(std::shared_ptr<Matrix> mat) override {
-        queue.push(mat);
+    // 在 attach 之后、生成矩阵之前调用；name 作为该观察者在追踪结果里的名字
+    void trace(Tracer& t, std::string name) {
+        tracer = &t;
+        track = t.addTrack(std::move(name));
     }
 
+    // BOUNDED_BLOCK 模式下已有排空任务时只是一次原子交换，不加锁也不入队
+    void notify() override {
+        if (!running) return;
+        MatrixFrame frame;
+        switch (policy.mode) {
+            case Delivery::QUEUE:
+                while (consumer->tryRead(frame)) {
+                    if (tracer) frame.enqueued = tracer->now();
+                    mailbox.push(std::move(frame));
+                }
+                break;
+            case Delivery::CONFLATE:
+                // 增量不能跳过，所以逐帧读出再合并
+                while (consumer->tryRead(frame)) {
+                    if (tracer) frame.enqueued = tracer->now();
+                    conflate(std::move(frame));
+                }
+                break;
+            case Delivery::BOUNDED_BLOCK:
+                break;
+        }
+        schedule();
+    }
+
+    // 与原来每线程一个观察者时相同：正在处理的矩阵处理完，尚未处理的直接丢弃。可重复调用
     void stop() override {
         running = false;
-        queue.push(std::make_shared<Matrix>()); // dummy to unblock
-        if (worker.joinable()) worker.join();
+        {
+            std::unique_lock<std::mutex> lock(idleMtx);
+            idleCv.wait(lock, [this] { return !scheduled; });
+        }
+        if (consumer) {
+            consumer->detach(); // 不再拦住生产者
+            consumer = nullptr;
+        }
+        mailbox.close();
+        mailbox.try_pop_bulk(inbox, std::numeric_limits<size_t>::max()); // 丢弃未处理的矩阵
+        inbox.clear();
+        std::lock_guard<std::mutex> lock(latestMtx);
+        latest.clear();
+    }
+
+    // 等到已经通知过的矩阵都处理完（CONFLATE 模式下被替换掉的不算）。不能与 generateMatrix 并发
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(idleMtx);
+        idleCv.wait(lock, [this] { return !running || (!scheduled && !hasPending()); });
+    }
+
+    // CONFLATE 模式下没来得及处理就被同类的新帧替换、或并入后一个增量的帧数
+    uint64_t conflatedCount() const {
+        return conflated;
+    }
+
+protected:
+    virtual void onMatrix(const Matrix& mat) = 0;
+
+    // 默认忽略增量；需要跟踪增量的观察者重写它，需要关键帧版本号的重写 onFrame
+    virtual void onDelta(const MatrixDelta& delta) {
+        (void)delta;
+    }
+
+    // 默认忽略文件映射的矩阵：它可能远大于内存，只有能按行块处理的观察者才应重写
+    virtual void onMapped(const MappedMatrix& mat) {
+        (void)mat;
+    }
+
+    virtual void onFrame(const MatrixFrame& frame) {
+        if (frame.matrix) {
+            onMatrix(*frame.matrix);
+        } else if (frame.mapped) {
+            onMapped(*frame.mapped);
+        } else {
+            onDelta(*frame.delta);
+        }
+    }
+
+private:
+    void schedule() {
+        if (!scheduled.exchange(true))
+            executor.post([this] { drain(); });
+    }
+
+    // 取下一个待处理的矩阵（QUEUE 模式在 drain 里成批取）
+    bool next(MatrixFrame& frame) {
+        if (policy.mode == Delivery::CONFLATE) {
+            std::lock_guard<std::mutex> lock(latestMtx);
+            if (latest.empty()) return false;
+            frame = std::move(latest.front());
+            latest.erase(latest.begin());
+            return true;
+        }
+        return consumer->tryRead(frame);
+    }
+
+    bool hasPending() {
+        switch (policy.mode) {
+            case Delivery::QUEUE:
+                return !mailbox.empty();
+            case Delivery::CONFLATE: {
+                std::lock_guard<std::mutex> lock(latestMtx);
+                return !latest.empty();
+            }
+            case Delivery::BOUNDED_BLOCK:
+                break;
+        }
+        return consumer->lag() > 0;
+    }
+
+    // 帧是否属于版本化矩阵的关键帧 / 增量序列
+    static bool versioned(const MatrixFrame& frame) {
+        return frame.delta || (frame.matrix && frame.grid.tiled());
+    }
+
+    // 新增量与待处理的增量合并，因为跳过增量会丢失改动；新关键帧只替换待处理的关键帧和增量，
+    // 其他矩阵只替换待处理的其他矩阵，不会打断增量序列
+    void conflate(MatrixFrame frame) {
+        std::lock_guard<std::mutex> lock(latestMtx);
+        uint64_t dropped = 0;
+        if (frame.delta) {
+            auto pending = std::find_if(latest.begin(), latest.end(),
+                                        [](const MatrixFrame& f) { return f.delta != nullptr; });
+            if (pending != latest.end()) {
+                pending->delta = MatrixDelta::merge(*pending->delta, *frame.delta);
+                pending->seq = frame.seq;
+                pending->enqueued = frame.enqueued;
+                dropped = 1;
+            } else {
+                latest.push_back(std::move(frame));
+            }
+        } else {
+            bool stream = versioned(frame);
+            auto stale = std::remove_if(latest.begin(), latest.end(),
+                                        [&](const MatrixFrame& f) { return versioned(f) == stream; });
+            dropped = static_cast<uint64_t>(latest.end() - stale);
+            latest.erase(stale, latest.end());
+            latest.push_back(std::move(frame));
+        }
+        conflated += dropped;
+        if (tracer && dropped > 0) tracer->recordDropped(track, dropped);
+    }
+
+    void process(MatrixFrame& frame) {
+        int64_t dequeued = tracer ? tracer->now() : 0;
+        onFrame(frame);
+        if (tracer) {
+            tracer->recordObserver(track, frame.seq, frame.generated, frame.enqueued, dequeued, tracer->now());
+        }
+        frame.matrix.reset(); // 所有持有者都释放后矩阵即回到池中
+        frame.delta.reset();
+        frame.mapped.reset();
+    }
+
+    void drain() {
+        if (policy.mode == Delivery::QUEUE) {
+            mailbox.try_pop_bulk(inbox, batch); // 一批只加一次锁
+            for (auto& frame : inbox) {
+                if (!running) break;
+                process(frame);
+            }
+            inbox.clear();
+        } else {
+            MatrixFrame frame;
+            for (size_t n = 0; n < batch && running && next(frame); ++n)
+                process(frame);
+        }
+        // 持锁通知：stop() 要等这把锁释放后才能返回，解锁之后本函数不再访问 this
+        std::lock_guard<std::mutex> lock(idleMtx);
+        scheduled = false;
+        if (running && hasPending()) {
+            schedule(); // 还有剩余，排到池的队尾
+        } else {
+            idleCv.notify_all();
+        }
     }
 };
 
-// ------------------- 渲染系统 --------------------
-class RenderSystem : public IMatrixObserver {
-    ThreadSafeQueue<std::shared_ptr<Matrix>> queue;
-    std::atomic<bool> running{true};
-    std::thread worker;
+// ------------------- 日志系统 --------------------
+class LoggerSystem : public AsyncObserver {
+public:
+    using AsyncObserver::AsyncObserver;
+
+protected:
+    void onMatrix(const Matrix& mat) override {
+        std::cout << "[Logger] Received matrix: "
+                << mat.rows() << "x" << mat.cols() << "\n";
+    }
+
+    void onDelta(const MatrixDelta& delta) override {
+        std::cout << "[Logger] Received delta v" << delta.baseVersion() << " -> v" << delta.version()
+                  << ": " << delta.size() << "/" << delta.grid().tileCount() << " tiles\n";
+    }
 
+    void onMapped(const MappedMatrix& mat) override {
+        std::cout << "[Logger] Received mapped matrix: " << mat.rows() << "x" << mat.cols()
+                  << " (" << mat.path() << ")\n";
+    }
+};
+
+// ------------------- 渲染系统 --------------------
+class RenderSystem : public AsyncObserver {
 public:
-    RenderSystem() {
-        worker = std::thread([this]() {
-            while (running) {
-                auto mat = queue.wait_and_pop();
-                if (mat->empty()) continue;
-
-                std::cout << "[Render] Rendering preview... ";
-                std::this_thread::sleep_for(std::chrono::milliseconds(200)); // 模拟耗时
-                std::cout << "Top-left = " << (*mat)[0][0] << "\n";
-            }
-        });
+    // 预览只需要最新的矩阵：渲染期间到达的旧矩阵直接丢弃，慢渲染既不拖住生产者也不积压。
+    // 每次只渲染一个就让出线程，慢观察者不会长时间占住池中的线程
+    explicit RenderSystem(WorkStealingExecutor& executor, DeliveryPolicy policy = {Delivery::CONFLATE})
+        : AsyncObserver(executor, policy, 1) {}
+
+protected:
+    void onMatrix(const Matrix& mat) override {
+        std::cout << "[Render] Rendering preview... ";
+        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // 模拟耗时
+        std::cout << "Top-left = " << mat(0, 0) << "\n";
     }
 
-    void submitMatrix(std::shared_ptr<Matrix> mat) override {
-        queue.push(mat);
+    // 只重绘改动过的块，耗时按块数比例计
+    void onDelta(const MatrixDelta& delta) override {
+        size_t total = delta.grid().tileCount();
+        std::cout << "[Render] Redrawing " << delta.size() << "/" << total << " tiles... ";
+        std::this_thread::sleep_for(std::chrono::milliseconds(200) * delta.size() / total); // 模拟耗时
+        for (size_t k = 0; k < delta.size(); ++k) {
+            if (delta.tile(k).index == 0) std::cout << "Top-left = " << delta.tile(k).data[0];
+        }
+        std::cout << "\n";
     }
 
-    void stop() override {
-        running = false;
-        queue.push(std::make_shared<Matrix>()); // dummy
-        if (worker.joinable()) worker.join();
+    // 预览只看左上角，只会读入文件的第一页
+    void onMapped(const MappedMatrix& mat) override {
+        std::cout << "[Render] Rendering mapped preview... ";
+        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // 模拟耗时
+        std::cout << "Top-left = " << mat(0, 0) << "\n";
     }
 };
 
 // ------------------- 计算系统 --------------------
-class ComputeSystem : public IMatrixObserver {
-    ThreadSafeQueue<std::shared_ptr<Matrix>> queue;
-    std::atomic<bool> running{true};
-    std::thread worker;
+// 完整矩阵和文件映射的矩阵都用 reduce::Accumulator 从上到下归约，结果与对同一矩阵调用 reduce 逐位相同。
+// 收到分块的关键帧后，增量只重算受影响的部分：
+//   - 块是整行宽的行带时，保留关键帧的副本和每条行带开始前的累加器状态，增量从第一条改动的行带接着累加，
+//     结果仍与 reduce 逐位相同；
+//   - 块是二维网格时，记下每块的统计量，增量只重算改动过的块再合并。合并丢掉了各块的 Kahan 补偿项，
+//     也与 reduce 的累加顺序不同，只是近似结果。
+// 文件映射的矩阵按行块流式归约，常驻内存只有一两个行块
+class ComputeSystem : public AsyncObserver {
+    reduce::Mode mode;
+    // 以下只由排空任务访问
+    TileGrid grid;
+    uint64_t version = 0;
+    bool haveKeyframe = false;
+    Matrix bands;                            // 行带：当前版本的内容
+    std::vector<reduce::Accumulator> prefix; // 行带：prefix[b] 为累加到第 b 条行带之前的状态
+    std::vector<reduce::Stats> tileStats;    // 二维网格：各块的统计量
 
 public:
-    ComputeSystem() {
-        worker = std::thread([this]() {
-            while (running) {
-                auto mat = queue.wait_and_pop();
-                if (mat->empty()) continue;
-
-                double sum = 0;
-                for (const auto& row : *mat)
-                    for (double val : row)
-                        sum += val;
-
-                std::cout << "[Compute] Matrix sum = " << sum << "\n";
+    explicit ComputeSystem(WorkStealingExecutor& executor, reduce::Mode mode = reduce::Mode::FAST,
+                           DeliveryPolicy policy = {})
+        : AsyncObserver(executor, policy), mode(mode) {}
+
+protected:
+    void onMatrix(const Matrix& mat) override {
+        print("Matrix", reduce::reduce(mat, mode)); // 向量化，一次遍历
+    }
+
+    void onFrame(const MatrixFrame& frame) override {
+        if (frame.matrix && frame.grid.tiled()) {
+            const Matrix& mat = *frame.matrix;
+            grid = frame.grid;
+            version = frame.version;
+            haveKeyframe = true;
+            if (rowBands()) {
+                bands = mat;
+                prefix.assign(bandCount() + 1, reduce::Accumulator(mode));
+                print("Matrix", accumulateFrom(0));
+            } else {
+                tileStats.resize(grid.tileCount());
+                for (size_t t = 0; t < tileStats.size(); ++t) {
+                    tileStats[t] = reduce::reduce(mat.row(grid.row0(t)).data() + grid.col0(t),
+                                                  grid.row1(t) - grid.row0(t), grid.col1(t) - grid.col0(t),
+                                                  mat.stride(), mode);
+                }
+                onMatrix(mat);
             }
+        } else if (frame.matrix) {
+            haveKeyframe = false;
+            onMatrix(*frame.matrix);
+        } else if (frame.mapped) {
+            onMapped(*frame.mapped); // 与增量的版本无关，分块状态保持不变
+        } else {
+            const MatrixDelta& delta = *frame.delta;
+            if (!haveKeyframe || delta.baseVersion() != version) {
+                std::cout << "[Compute] Skipping delta v" << delta.version() << ": no keyframe for v"
+                          << delta.baseVersion() << "\n";
+                return;
+            }
+            version = delta.version();
+            if (rowBands()) {
+                size_t first = bandCount();
+                for (size_t k = 0; k < delta.size(); ++k) {
+                    MatrixDelta::Tile tl = delta.tile(k);
+                    for (size_t i = tl.r0; i < tl.r1; ++i) {
+                        const double* src = tl.data + (i - tl.r0) * (tl.c1 - tl.c0);
+                        std::copy(src, src + (tl.c1 - tl.c0), bands.row(i).begin() + tl.c0);
+                    }
+                    first = std::min(first, tl.index);
+                }
+                print("Delta", accumulateFrom(first));
+            } else {
+                for (size_t k = 0; k < delta.size(); ++k) {
+                    MatrixDelta::Tile tl = delta.tile(k);
+                    tileStats[tl.index] = reduce::reduce(tl.data, tl.r1 - tl.r0, tl.c1 - tl.c0, tl.c1 - tl.c0, mode);
+                }
+                print("Delta", combine(tileStats));
+            }
+        }
+    }
+
+    void onMapped(const MappedMatrix& mat) override {
+        reduce::Accumulator acc(mode);
+        mat.forEachChunk([&](const double* data, size_t r0, size_t r1) {
+            acc.add(data, r1 - r0, mat.cols(), mat.stride());
         });
+        print("Mapped", acc.result());
     }
 
-    void submitMatrix(std::shared_ptr<Matrix> mat) override {
-        queue.push(mat);
+private:
+    // 每块横跨整行时块号就是行带号
+    bool rowBands() const { return grid.tilesPerRow() == 1; }
+    size_t bandCount() const { return grid.tileCount(); }
+
+    // 从 prefix[first] 接着累加第 first 条及之后的行带，更新其后各条行带的起始状态
+    reduce::Stats accumulateFrom(size_t first) {
+        reduce::Accumulator acc = prefix[first];
+        for (size_t b = first; b < bandCount(); ++b) {
+            acc.add(bands.row(grid.row0(b)).data(), grid.row1(b) - grid.row0(b), bands.cols(), bands.stride());
+            prefix[b + 1] = acc;
+        }
+        return acc.result();
     }
 
-    void stop() override {
-        running = false;
-        queue.push(std::make_shared<Matrix>()); // dummy
-        if (worker.joinable()) worker.join();
+    // 二维网格：按块号顺序合并，结果只取决于各块的内容
+    static reduce::Stats combine(const std::vector<reduce::Stats>& parts) {
+        reduce::Stats st;
+        double sq = 0;
+        for (const reduce::Stats& t : parts) {
+            st.count += t.count;
+            st.sum += t.sum;
+            sq += t.l2 * t.l2;
+            st.min = std::min(st.min, t.min);
+            st.max = std::max(st.max, t.max);
+        }
+        st.mean = st.count > 0 ? st.sum / static_cast<double>(st.count) : 0;
+        st.l2 = std::sqrt(sq);
+        return st;
+    }
+
+    void print(const char* what, const reduce::Stats& st) const {
+        std::cout << "[Compute] " << what << " sum = " << st.sum << ", mean = " << st.mean
+                  << ", min = " << st.min << ", max = " << st.max << ", L2 = " << st.l2 << "\n";
     }
 };
 
 // ------------------- 被观察者 --------------------
 class MatrixGenerator {
     std::vector<IMatrixObserver*> observers;
+    MatrixPool pool; // 观察者都释放后矩阵回到池中，稳态下不再分配
+    MatrixRing ring; // 每个矩阵只发布一次
+    Tracer* tracer = nullptr;
+    uint64_t nextSeq = 0;
+    WorkStealingExecutor* fillExecutor;
+    fill::TileFill fillFn = fill::indexTile;
 
 public:
+    // ringCapacity：BOUNDED_BLOCK 观察者最多落后多少个矩阵，超过后生产者按 wait 策略等待；
+    // fillExecutor：大矩阵分块并行填充用的线程池，为空时在调用线程里填充
+    explicit MatrixGenerator(size_t ringCapacity = 1024, WaitStrategy wait = WaitStrategy::BLOCKING,
+                             WorkStealingExecutor* fillExecutor = nullptr)
+        : ring(ringCapacity, wait), fillExecutor(fillExecutor) {}
+
+    // 在生成矩阵的线程调用；观察者从之后发布的矩阵开始接收
     void addObserver(IMatrixObserver* obs) {
+        obs->attach(ring);
         observers.push_back(obs);
     }
 
+    // 在生成矩阵之前调用
+    void setTracer(Tracer* t) {
+        tracer = t;
+    }
+
+    // 替换默认的 (i, j) = i * cols + j；fn 会在多个线程上同时被调用，各自填充不相交的块
+    void setFill(fill::TileFill fn) {
+        fillFn = std::move(fn);
+    }
+
     void generateMatrix(size_t rows, size_t cols) {
-        auto mat = std::make_shared<Matrix>(rows, std::vector<double>(cols, 0.0));
-        for (size_t i = 0; i < rows; ++i)
-            for (size_t j = 0; j < cols; ++j)
-                (*mat)[i][j] = static_cast<double>(i * cols + j);
+        int64_t start = tracer ? tracer->now() : 0;
+        auto mat = pool.acquire(rows, cols);
+        fill::fillTiles(*mat, fillFn, fillExecutor);
 
         // std::cout << "[MatrixGenerator] Generated matrix " << rows << "x" << cols << "\n";
 
+        MatrixFrame frame;
+        frame.matrix = std::move(mat);
+        publish(std::move(frame), start);
+    }
+
+    // 把 m 的当前内容作为关键帧发布，之后的增量以它的版本为基准
+    void publishKeyframe(VersionedMatrix& m) {
+        int64_t start = tracer ? tracer->now() : 0;
+        const Matrix& src = m.matrix();
+        auto mat = pool.acquire(src.rows(), src.cols());
+        for (size_t i = 0; i < src.rows(); ++i)
+            std::copy(src.row(i).begin(), src.row(i).end(), mat->row(i).begin());
+        MatrixFrame frame;
+        frame.matrix = std::move(mat);
+        frame.grid = m.grid();
+        frame.version = m.commit();
+        publish(std::move(frame), start);
+    }
+
+    // 只发布 m 自上次发布以来改动过的块；没有改动时什么也不做
+    void publishDelta(VersionedMatrix& m) {
+        int64_t start = tracer ? tracer->now() : 0;
+        MatrixFrame frame;
+        frame.delta = m.takeDelta();
+        if (frame.delta) publish(std::move(frame), start);
+    }
+
+    // 在 path 上新建 rows x cols 的文件矩阵，按行块填充后发布；它可以远大于内存。
+    // 文件在所有观察者处理完之后才可以删除。失败时返回 false
+    bool generateMapped(const std::string& path, size_t rows, size_t cols) {
+        int64_t start = tracer ? tracer->now() : 0;
+        auto mat = MappedMatrix::create(path, rows, cols);
+        if (!mat) return false;
+        mat->fillChunks([&](double* data, size_t r0, size_t r1) {
+            fill::indexRows(data, mat->stride(), cols, r0, r1, 0, cols);
+        });
+        MatrixFrame frame;
+        frame.mapped = std::move(mat);
+        publish(std::move(frame), start);
+        return true;
+    }
+
+    MatrixPool::Stats poolStats() const {
+        return pool.stats();
+    }
+
+private:
+    void publish(MatrixFrame frame, int64_t start) {
+        frame.seq = nextSeq++;
+        frame.generated = frame.enqueued = tracer ? tracer->now() : 0;
+        uint64_t seq = frame.seq;
+        int64_t generated = frame.generated;
+        ring.publish(std::move(frame)); // 一次发布，不再逐个观察者入队
+        if (tracer) tracer->recordGenerate(seq, start, generated, tracer->now());
         for (auto* obs : observers)
-            obs->submitMatrix(mat); // 异步传递引用
+            obs->notify();
     }
 };
 
 // ------------------- 主程序 --------------------
-int main() {
-    LoggerSystem logger;
-    RenderSystem renderer;
-    ComputeSystem calculator;
-
-    MatrixGenerator generator;
+// 用法：async [trace.json]，给出路径时把每个矩阵的事件导出为 Chrome trace-event JSON
+int main(int argc, char* argv[]) {
+    const char* tracePath = argc > 1 ? argv[1] : nullptr;
+    Tracer tracer(tracePath != nullptr);
+
+    WorkStealingExecutor executor; // 所有观察者共用，线程数与观察者数无关
+    LoggerSystem logger(executor);
+    RenderSystem renderer(executor);
+    ComputeSystem calculator(executor);
+
+    MatrixGenerator generator(1024, WaitStrategy::BLOCKING, &executor);
+    generator.setTracer(&tracer);
     generator.addObserver(&logger);
     generator.addObserver(&renderer);
     generator.addObserver(&calculator);
+    logger.trace(tracer, "logger");
+    renderer.trace(tracer, "render");
+    calculator.trace(tracer, "compute");
 
     for (int i=0; i<1000; i++)
         generator.generateMatrix(100, 100);
 
-    std::this_thread::sleep_for(std::chrono::seconds(1)); // 等待各系统处理完
+    // 稳态：每生成一个就等日志和计算处理完，同时在用的矩阵只有几个（渲染最多再持有两个）。
+    // 环上的槽位在下一次发布时才清空，所以前两个用来让上面积压的矩阵全部回到池中，
+    // 之后应当全部来自池，misses 不再增长
+    uint64_t warmMisses = 0;
+    for (int i = 0; i < 102; ++i) {
+        generator.generateMatrix(100, 100);
+        logger.waitIdle();
+        calculator.waitIdle();
+        if (i == 1) warmMisses = generator.poolStats().misses;
+    }
+    uint64_t steadyMisses = generator.poolStats().misses - warmMisses;
+
+    // 稀疏更新：先发一个关键帧，之后每次只改几个元素，只发布改动过的块
+    VersionedMatrix live(1024, 1024);
+    for (size_t i = 0; i < live.matrix().rows(); ++i)
+        for (size_t j = 0; j < live.matrix().cols(); ++j)
+            live.set(i, j, static_cast<double>(i + j));
+    generator.publishKeyframe(live);
+    for (int step = 1; step <= 100; ++step) {
+        for (int k = 0; k < 3; ++k) {
+            size_t i = (step * 131 + k * 977) % 1024, j = (step * 71 + k * 389) % 1024;
+            live.set(i, j, live(i, j) + step);
+        }
+        generator.publishDelta(live);
+    }
+
+    // 文件映射的大矩阵：计算系统按行块流式归约，不把整个矩阵读进内存
+    std::string mappedPath = "async-mapped.bin";
+    generator.generateMapped(mappedPath, 4096, 1000);
+
+    // 等待各系统处理完
+    logger.waitIdle();
+    renderer.waitIdle();
+    calculator.waitIdle();
+    std::remove(mappedPath.c_str());
 
     logger.stop();
     renderer.stop();
     calculator.stop();
 
+    std::cout << "[Render] skipped or merged " << renderer.conflatedCount() << " stale frames\n";
+    auto stats = generator.poolStats();
+    std::cout << "[Pool] hits = " << stats.hits << ", misses = " << stats.misses
+              << ", cached = " << stats.cached << " (" << stats.cachedBytes / 1024 << " KiB)"
+              << ", steady-state misses = " << steadyMisses << "\n";
+    tracer.report(std::cout);
+    if (tracePath) {
+        std::ofstream out(tracePath);
+        tracer.writeChromeTrace(out);
+        std::cout << "[Trace] written to " << tracePath << "\n";
+    }
+    if (steadyMisses != 0) {
+        std::cout << "FAILED: matrices are not reused in steady state" << std::endl;
+        return 1;
+    }
     std::cout << "ok" << std::endl;
     return 0;
 }
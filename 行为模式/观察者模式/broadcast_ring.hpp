@@ -0,0 +1,200 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 生产者 / 消费者等待对方时的策略
+enum class WaitStrategy {
+    BUSY_SPIN,  // 一直自旋，延迟最低，占满一个核
+    YIELD,      // 自旋一小会儿后让出 CPU
+    BLOCKING    // 在条件变量上睡眠，不占 CPU，唤醒有系统调用开销
+};
+
+// ------------------- 单生产者广播环 --------------------
+// Disruptor 风格：生产者每个元素只发布一次，所有消费者读同一个槽位，各自推进自己的序号。
+// 生产者写第 n 个元素前，要等每个消费者都读完第 n - limit 个（limit 为该消费者最多落后的元素数，
+// 不超过 capacity），即慢消费者反压生产者。
+// 所有消费者都读过的槽位由生产者在下一次 publish 时清空（赋值为 T()），元素持有的资源随之释放，
+// 不必等到被下一圈覆盖。分离的消费者由生产者在下一次 publish 或 addConsumer 时回收，
+// 反复订阅、退订不会让消费者列表增长。
+template<typename T>
+class BroadcastRing {
+public:
+    class Consumer {
+    public:
+        // 有未读元素时拷贝出下一个并返回 true，否则立即返回 false
+        bool tryRead(T& out) {
+            int64_t next = sequence.load(std::memory_order_relaxed) + 1;
+            if (ring.cursor.load() < next) return false;
+            out = ring.slots[next & ring.mask];
+            advance(next);
+            return true;
+        }
+
+        // 按环的等待策略等到下一个元素；环已关闭且读完时返回 false
+        bool read(T& out) {
+            int64_t next = sequence.load(std::memory_order_relaxed) + 1;
+            ring.waitUntil([&] { return ring.cursor.load() >= next || ring.closed.load(); });
+            if (ring.cursor.load() < next) return false;
+            out = ring.slots[next & ring.mask];
+            advance(next);
+            return true;
+        }
+
+        // 尚未读取的元素个数
+        int64_t lag() const {
+            int64_t seq = sequence.load(std::memory_order_relaxed);
+            return seq == kDetached ? 0 : ring.cursor.load() - seq;
+        }
+
+        // 不再消费，也不再拦住生产者；可以从任意线程调用。
+        // 之后不能再使用这个消费者：生产者线程随时可能回收它，所以这里先取出 ring，存入 kDetached 后不再访问成员
+        void detach() {
+            BroadcastRing& r = ring;
+            sequence.store(kDetached);
+            r.detachPending.store(true);
+            r.wakeAll();
+        }
+
+    private:
+        friend class BroadcastRing;
+
+        Consumer(BroadcastRing& ring, int64_t start, int64_t limit) : ring(ring), limit(limit), sequence(start) {}
+
+        void advance(int64_t seq) {
+            sequence.store(seq);
+            if (ring.strategy == WaitStrategy::BLOCKING) ring.wakeAll();  // 生产者可能在等空位
+        }
+
+        BroadcastRing& ring;
+        const int64_t limit;
+        alignas(64) std::atomic<int64_t> sequence;  // 已读到的序号，只有所属消费者写入
+    };
+
+    // capacity 向上取整为 2 的幂
+    explicit BroadcastRing(size_t capacity, WaitStrategy strategy = WaitStrategy::BLOCKING)
+        : mask(roundUpPow2(capacity) - 1), strategy(strategy), slots(mask + 1) {}
+
+    BroadcastRing(const BroadcastRing&) = delete;
+    BroadcastRing& operator=(const BroadcastRing&) = delete;
+
+    // 与 publish 在同一线程调用；新消费者从下一个发布的元素开始读。
+    // limit：该消费者最多落后的元素数，0 或超过容量时取容量
+    Consumer& addConsumer(size_t limit = 0) {
+        if (limit == 0 || limit > capacity()) limit = capacity();
+        reapDetached();
+        consumers.emplace_back(new Consumer(*this, cursor.load(), static_cast<int64_t>(limit)));
+        gatingCache = -1;
+        return *consumers.back();
+    }
+
+    // 仅限单个生产者线程调用；环满时按等待策略等最慢的消费者
+    void publish(T value) {
+        int64_t next = claimed + 1;
+        if (next > gatingCache) {
+            waitUntil([&] { return (gatingCache = gate()) >= next; });
+        }
+        reapDetached();
+        release();
+        slots[next & mask] = std::move(value);
+        claimed = next;
+        cursor.store(next);  // seq_cst：与消费者“清除已调度标志后再检查 lag”配对
+        if (strategy == WaitStrategy::BLOCKING) wakeAll();
+    }
+
+    // 之后 read() 读完剩余元素即返回 false
+    void close() {
+        closed.store(true);
+        wakeAll();
+    }
+
+    int64_t published() const { return cursor.load(); }
+    size_t capacity() const { return mask + 1; }
+
+private:
+    static constexpr int64_t kDetached = std::numeric_limits<int64_t>::max();
+
+    static size_t roundUpPow2(size_t n) {
+        size_t cap = 1;
+        while (cap < n) cap <<= 1;
+        return cap;
+    }
+
+    // 当前最多可以发布到的序号
+    int64_t gate() const {
+        int64_t limit = kDetached;
+        for (auto& c : consumers) {
+            int64_t seq = c->sequence.load(std::memory_order_acquire);
+            if (seq != kDetached) limit = std::min(limit, seq + c->limit);
+        }
+        return limit;
+    }
+
+    // 从列表中删去已分离的消费者，之后 gate() / release() 不再遍历它们。只在生产者线程调用
+    void reapDetached() {
+        if (!detachPending.exchange(false)) return;
+        auto detached = [](const std::unique_ptr<Consumer>& c) { return c->sequence.load() == kDetached; };
+        consumers.erase(std::remove_if(consumers.begin(), consumers.end(), detached), consumers.end());
+    }
+
+    // 清空所有未分离的消费者都已读过的槽位；消费者先拷贝出元素再推进序号，所以这些槽位不会再被读取
+    void release() {
+        int64_t done = claimed;
+        for (auto& c : consumers) {
+            int64_t seq = c->sequence.load(std::memory_order_acquire);
+            if (seq != kDetached) done = std::min(done, seq);
+        }
+        for (; released < done; ++released) slots[(released + 1) & mask] = T();
+    }
+
+    template<typename Pred>
+    void waitUntil(Pred ready) {
+        switch (strategy) {
+            case WaitStrategy::BUSY_SPIN:
+                while (!ready()) {}
+                break;
+            case WaitStrategy::YIELD:
+                for (int spins = 0; !ready(); ++spins) {
+                    if (spins >= 100) std::this_thread::yield();
+                }
+                break;
+            case WaitStrategy::BLOCKING:
+                if (ready()) return;
+                std::unique_lock<std::mutex> lock(waitMtx);
+                waiters.fetch_add(1);
+                waitCv.wait(lock, ready);
+                waiters.fetch_sub(1);
+                break;
+        }
+    }
+
+    // 只有真的有线程在睡眠时才加锁通知
+    void wakeAll() {
+        if (waiters.load() == 0) return;
+        {
+            std::lock_guard<std::mutex> lock(waitMtx);
+        }
+        waitCv.notify_all();
+    }
+
+    const size_t mask;
+    const WaitStrategy strategy;
+    std::vector<T> slots;
+    std::vector<std::unique_ptr<Consumer>> consumers;  // 只由生产者线程增删
+    alignas(64) std::atomic<int64_t> cursor{-1};       // 已发布的最大序号
+    int64_t claimed = -1;                              // 以下三项仅生产者线程访问
+    int64_t gatingCache = -1;                          // gate() 的缓存，减少遍历消费者
+    int64_t released = -1;                             // 已清空到的序号
+    std::atomic<bool> closed{false};
+    std::atomic<bool> detachPending{false};            // 有消费者分离后尚未回收
+    std::atomic<int> waiters{0};
+    std::mutex waitMtx;
+    std::condition_variable waitCv;
+};
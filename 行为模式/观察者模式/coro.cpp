@@ -0,0 +1,116 @@
+// 协程版的观察者：g++ -std=c++20 -O2 -pthread coro.cpp
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "coroutine.hpp"
+#include "executor.hpp"
+#include "fill.hpp"
+#include "matrix.hpp"
+#include "matrix_pool.hpp"
+#include "reduce.hpp"
+
+using MatrixChannel = Channel<std::shared_ptr<Matrix>>;
+
+// ------------------- 观察者协程 --------------------
+// 每个观察者是一个协程加一个通道，写法与每线程一个观察者时的循环相同，但等待时不占线程
+
+CoTask loggerSystem(MatrixChannel& in) {
+    while (auto mat = co_await in.next()) {
+        std::cout << "[Logger] Received matrix: " << (*mat)->rows() << "x" << (*mat)->cols() << "\n";
+    }
+}
+
+// 渲染的 200ms 用定时器等待，期间线程去执行别的观察者
+CoTask renderSystem(CoScheduler& scheduler, MatrixChannel& in) {
+    while (auto mat = co_await in.next()) {
+        std::cout << "[Render] Rendering preview...\n";
+        co_await scheduler.sleep(std::chrono::milliseconds(200)); // 模拟耗时
+        std::cout << "[Render] Top-left = " << (**mat)(0, 0) << "\n";
+    }
+}
+
+CoTask computeSystem(MatrixChannel& in, reduce::Mode mode) {
+    while (auto mat = co_await in.next()) {
+        reduce::Stats st = reduce::reduce(**mat, mode);
+        std::cout << "[Compute] Matrix sum = " << st.sum << ", mean = " << st.mean
+                  << ", min = " << st.min << ", max = " << st.max << ", L2 = " << st.l2 << "\n";
+    }
+}
+
+// 大量观察者时用的计数协程，偶尔等一下模拟 I/O
+CoTask counterSystem(CoScheduler& scheduler, MatrixChannel& in, std::atomic<uint64_t>& total) {
+    uint64_t n = 0;
+    while (auto mat = co_await in.next()) {
+        total.fetch_add(1, std::memory_order_relaxed);
+        if (++n % 8 == 0) co_await scheduler.sleep(std::chrono::milliseconds(1));
+    }
+}
+
+// ------------------- 被观察者 --------------------
+class MatrixGenerator {
+    std::vector<MatrixChannel*> channels;
+    MatrixPool pool;
+
+public:
+    void addObserver(MatrixChannel* ch) {
+        channels.push_back(ch);
+    }
+
+    void generateMatrix(size_t rows, size_t cols) {
+        auto mat = pool.acquire(rows, cols);
+        fill::fillTiles(*mat, fill::indexTile);
+        for (auto* ch : channels)
+            ch->send(mat);
+    }
+
+    // 关闭所有通道，观察者处理完剩余矩阵后结束
+    void close() {
+        for (auto* ch : channels)
+            ch->close();
+    }
+};
+
+// ------------------- 主程序 --------------------
+int main() {
+    WorkStealingExecutor executor(2); // 所有协程共用两个线程
+    CoScheduler scheduler(executor);
+
+    MatrixChannel logIn(scheduler), renderIn(scheduler), computeIn(scheduler);
+    MatrixGenerator generator;
+    generator.addObserver(&logIn);
+    generator.addObserver(&renderIn);
+    generator.addObserver(&computeIn);
+    scheduler.spawn(loggerSystem(logIn));
+    scheduler.spawn(renderSystem(scheduler, renderIn));
+    scheduler.spawn(computeSystem(computeIn, reduce::Mode::FAST));
+
+    for (int i = 0; i < 5; i++)
+        generator.generateMatrix(100, 100);
+    generator.close();
+    scheduler.join();
+
+    // 一万个观察者复用同两个线程
+    const size_t kObservers = 10000, kMatrices = 32;
+    std::atomic<uint64_t> total{0};
+    std::vector<std::unique_ptr<MatrixChannel>> inputs;
+    MatrixGenerator fanout;
+    for (size_t i = 0; i < kObservers; ++i) {
+        inputs.push_back(std::make_unique<MatrixChannel>(scheduler));
+        fanout.addObserver(inputs.back().get());
+        scheduler.spawn(counterSystem(scheduler, *inputs.back(), total));
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kMatrices; ++i)
+        fanout.generateMatrix(1, 1);
+    fanout.close();
+    scheduler.join();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "[Fan-out] " << kObservers << " observers x " << kMatrices << " matrices on "
+              << executor.size() << " threads in " << ms << " ms, delivered = " << total << "\n";
+    std::cout << "ok" << std::endl;
+    return 0;
+}
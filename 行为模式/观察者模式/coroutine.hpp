@@ -0,0 +1,244 @@
+#pragma once
+// 需要 C++20（-std=c++20）
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "executor.hpp"
+
+// ------------------- 协程观察者运行时 --------------------
+// 观察者写成协程：co_await channel.next() 等下一个元素，co_await scheduler.sleep(...) 等一段时间。
+// 挂起的协程只占一个协程帧，不占线程；就绪的协程由 WorkStealingExecutor 恢复执行，
+// 所以成千上万个观察者可以复用几个线程。
+
+class CoScheduler;
+
+// 由 CoScheduler::spawn 启动的协程的返回类型；协程结束后自行销毁
+class CoTask {
+public:
+    struct promise_type {
+        CoScheduler* scheduler = nullptr;
+
+        CoTask get_return_object() { return CoTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }  // 由 spawn 投递到线程池后才开始执行
+        auto final_suspend() noexcept;
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    CoTask(CoTask&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    CoTask(const CoTask&) = delete;
+    CoTask& operator=(const CoTask&) = delete;
+
+    ~CoTask() {
+        if (handle) handle.destroy();  // 从未 spawn 的协程
+    }
+
+private:
+    friend class CoScheduler;
+
+    explicit CoTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+class CoScheduler {
+public:
+    explicit CoScheduler(WorkStealingExecutor& executor) : executor(executor), timerThread([this] { runTimers(); }) {}
+
+    // 先等所有协程结束再析构
+    ~CoScheduler() {
+        join();
+        {
+            std::lock_guard<std::mutex> lock(timerMtx);
+            stopping = true;
+        }
+        timerCv.notify_one();
+        timerThread.join();
+    }
+
+    CoScheduler(const CoScheduler&) = delete;
+    CoScheduler& operator=(const CoScheduler&) = delete;
+
+    void spawn(CoTask task) {
+        auto h = std::exchange(task.handle, nullptr);
+        h.promise().scheduler = this;
+        {
+            std::lock_guard<std::mutex> lock(joinMtx);
+            ++live;
+        }
+        resume(h);
+    }
+
+    // 在线程池里恢复 h
+    void resume(std::coroutine_handle<> h) {
+        executor.post([h] { h.resume(); });
+    }
+
+    // 等所有 spawn 出去的协程结束；不能在协程里调用
+    void join() {
+        std::unique_lock<std::mutex> lock(joinMtx);
+        joinCv.wait(lock, [this] { return live == 0; });
+    }
+
+    // co_await scheduler.sleep(d)：挂起 d 之后在线程池里继续，等待期间不占线程
+    auto sleep(std::chrono::steady_clock::duration d) {
+        struct Awaiter {
+            CoScheduler& s;
+            std::chrono::steady_clock::time_point deadline;
+
+            bool await_ready() const { return deadline <= std::chrono::steady_clock::now(); }
+            void await_suspend(std::coroutine_handle<> h) { s.addTimer(deadline, h); }
+            void await_resume() const {}
+        };
+        return Awaiter{*this, std::chrono::steady_clock::now() + d};
+    }
+
+private:
+    friend class CoTask;
+
+    struct Timer {
+        std::chrono::steady_clock::time_point deadline;
+        std::coroutine_handle<> handle;
+        bool operator>(const Timer& other) const { return deadline > other.deadline; }
+    };
+
+    // 持锁递减并通知：join() 返回后调度器可能立即析构
+    void finished() {
+        std::lock_guard<std::mutex> lock(joinMtx);
+        if (--live == 0) joinCv.notify_all();
+    }
+
+    void addTimer(std::chrono::steady_clock::time_point deadline, std::coroutine_handle<> h) {
+        {
+            std::lock_guard<std::mutex> lock(timerMtx);
+            timers.push({deadline, h});
+        }
+        timerCv.notify_one();
+    }
+
+    // 一个线程管理所有定时器，到期的协程交给线程池
+    void runTimers() {
+        std::unique_lock<std::mutex> lock(timerMtx);
+        while (!stopping) {
+            auto now = std::chrono::steady_clock::now();
+            while (!timers.empty() && timers.top().deadline <= now) {
+                resume(timers.top().handle);
+                timers.pop();
+            }
+            if (timers.empty()) {
+                timerCv.wait(lock);
+            } else {
+                timerCv.wait_until(lock, timers.top().deadline);
+            }
+        }
+    }
+
+    WorkStealingExecutor& executor;
+    size_t live = 0;              // 尚未结束的协程数，受 joinMtx 保护
+    std::mutex joinMtx;
+    std::condition_variable joinCv;
+    std::mutex timerMtx;
+    std::condition_variable timerCv;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    bool stopping = false;
+    std::thread timerThread;  // 放在最后，其余成员都初始化后才启动
+};
+
+inline auto CoTask::promise_type::final_suspend() noexcept {
+    // 协程帧随之销毁；之后 join() 才可能返回，不会有人再访问它
+    struct Awaiter {
+        bool await_ready() noexcept { return false; }
+        void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+            CoScheduler* s = h.promise().scheduler;
+            h.destroy();
+            s->finished();
+        }
+        void await_resume() noexcept {}
+    };
+    return Awaiter{};
+}
+
+// ------------------- 可等待的通道 --------------------
+// 多个生产者、一个消费者协程。send() 可以在任意线程调用，不会阻塞；
+// co_await next() 在通道为空时挂起，有元素或通道关闭时由 send() / close() 交给线程池恢复。
+// 关闭并取完之后 next() 得到 std::nullopt。
+template<typename T>
+class Channel {
+public:
+    explicit Channel(CoScheduler& scheduler) : scheduler(scheduler) {}
+
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+
+    // 通道已关闭时丢弃 val 并返回 false
+    bool send(T val) {
+        std::coroutine_handle<> h;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (closed) return false;
+            items.push_back(std::move(val));
+            h = std::exchange(waiter, nullptr);
+        }
+        if (h) scheduler.resume(h);
+        return true;
+    }
+
+    void close() {
+        std::coroutine_handle<> h;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            closed = true;
+            h = std::exchange(waiter, nullptr);
+        }
+        if (h) scheduler.resume(h);
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return items.size();
+    }
+
+    auto next() {
+        struct Awaiter {
+            Channel& ch;
+
+            bool await_ready() {
+                std::lock_guard<std::mutex> lock(ch.mtx);
+                return !ch.items.empty() || ch.closed;
+            }
+
+            // 检查与登记在同一把锁内，send() 不会错过这次挂起
+            bool await_suspend(std::coroutine_handle<> h) {
+                std::lock_guard<std::mutex> lock(ch.mtx);
+                if (!ch.items.empty() || ch.closed) return false;
+                ch.waiter = h;
+                return true;
+            }
+
+            std::optional<T> await_resume() {
+                std::lock_guard<std::mutex> lock(ch.mtx);
+                if (ch.items.empty()) return std::nullopt;
+                std::optional<T> val(std::move(ch.items.front()));
+                ch.items.pop_front();
+                return val;
+            }
+        };
+        return Awaiter{*this};
+    }
+
+private:
+    CoScheduler& scheduler;
+    std::mutex mtx;
+    std::deque<T> items;
+    std::coroutine_handle<> waiter;  // 挂起在 next() 上的消费者
+    bool closed = false;
+};
@@ -0,0 +1,174 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "matrix.hpp"
+
+// ------------------- 分块版本化矩阵与增量 --------------------
+// 矩阵按 tileRows x tileCols 分块。生产者改动若干元素后只发布改动过的块（MatrixDelta）和新的版本号，
+// 观察者核对版本号后把增量应用到自己维护的状态上；更新稀疏时，发布和处理的数据量只与改动的块数有关。
+
+// 分块方式；tileRows 或 tileCols 为 0 表示不分块
+struct TileGrid {
+    size_t rows = 0;
+    size_t cols = 0;
+    size_t tileRows = 0;
+    size_t tileCols = 0;
+
+    bool tiled() const { return tileRows > 0 && tileCols > 0; }
+    size_t tilesPerRow() const { return (cols + tileCols - 1) / tileCols; }
+    size_t tileCount() const { return tiled() ? (rows + tileRows - 1) / tileRows * tilesPerRow() : 0; }
+    size_t tileOf(size_t i, size_t j) const { return i / tileRows * tilesPerRow() + j / tileCols; }
+
+    // 第 t 块覆盖行 [row0, row1)、列 [col0, col1)
+    size_t row0(size_t t) const { return t / tilesPerRow() * tileRows; }
+    size_t row1(size_t t) const { return std::min(row0(t) + tileRows, rows); }
+    size_t col0(size_t t) const { return t % tilesPerRow() * tileCols; }
+    size_t col1(size_t t) const { return std::min(col0(t) + tileCols, cols); }
+};
+
+// 版本 baseVersion 到 version 之间改动过的块的新内容，创建后只读
+class MatrixDelta {
+public:
+    struct Tile {
+        size_t index;       // 块号
+        size_t r0, r1, c0, c1;
+        const double* data; // 按行连续存放，行间隔为 c1 - c0
+    };
+
+    MatrixDelta(const TileGrid& grid, uint64_t baseVersion, uint64_t version)
+        : g(grid), base(baseVersion), ver(version) {}
+
+    // 从 src 拷贝第 t 块；同一块只能加入一次
+    void addTile(size_t t, const Matrix& src) {
+        offsets.push_back(values.size());
+        indices.push_back(t);
+        for (size_t i = g.row0(t); i < g.row1(t); ++i) {
+            const double* row = src.row(i).data();
+            values.insert(values.end(), row + g.col0(t), row + g.col1(t));
+        }
+    }
+
+    // older 之后紧接着 newer 的合并结果：同一块以 newer 为准
+    static std::shared_ptr<MatrixDelta> merge(const MatrixDelta& older, const MatrixDelta& newer) {
+        auto out = std::make_shared<MatrixDelta>(newer.g, older.base, newer.ver);
+        std::vector<bool> taken(newer.g.tileCount());
+        for (size_t k = 0; k < newer.size(); ++k) {
+            out->copyTile(newer, k);
+            taken[newer.indices[k]] = true;
+        }
+        for (size_t k = 0; k < older.size(); ++k) {
+            if (!taken[older.indices[k]]) out->copyTile(older, k);
+        }
+        return out;
+    }
+
+    const TileGrid& grid() const { return g; }
+    uint64_t baseVersion() const { return base; }
+    uint64_t version() const { return ver; }
+    size_t size() const { return indices.size(); }
+
+    Tile tile(size_t k) const {
+        size_t t = indices[k];
+        return {t, g.row0(t), g.row1(t), g.col0(t), g.col1(t), values.data() + offsets[k]};
+    }
+
+    // 把改动写进 mat（形状须与 grid 一致）
+    void applyTo(Matrix& mat) const {
+        for (size_t k = 0; k < size(); ++k) {
+            Tile tl = tile(k);
+            size_t width = tl.c1 - tl.c0;
+            for (size_t i = tl.r0; i < tl.r1; ++i) {
+                std::memcpy(mat.row(i).data() + tl.c0, tl.data + (i - tl.r0) * width, width * sizeof(double));
+            }
+        }
+    }
+
+private:
+    void copyTile(const MatrixDelta& from, size_t k) {
+        size_t begin = from.offsets[k];
+        size_t end = k + 1 < from.size() ? from.offsets[k + 1] : from.values.size();
+        offsets.push_back(values.size());
+        indices.push_back(from.indices[k]);
+        values.insert(values.end(), from.values.begin() + begin, from.values.begin() + end);
+    }
+
+    TileGrid g;
+    uint64_t base;
+    uint64_t ver;
+    std::vector<size_t> indices;
+    std::vector<size_t> offsets; // 每块在 values 中的起点
+    std::vector<double> values;
+};
+
+// 生产者持有的完整矩阵：修改时标记脏块，takeDelta() 取出脏块并推进版本
+class VersionedMatrix {
+public:
+    // 块宽取 8 的倍数时，每块的行起点都在缓存行边界上
+    VersionedMatrix(size_t rows, size_t cols, size_t tileRows = 64, size_t tileCols = 64)
+        : mat(rows, cols), g{rows, cols, tileRows, tileCols}, dirtyFlags(g.tileCount()) {}
+
+    const Matrix& matrix() const { return mat; }
+    const TileGrid& grid() const { return g; }
+    uint64_t version() const { return ver; }
+    bool dirty() const { return !dirtyList.empty(); }
+
+    double operator()(size_t i, size_t j) const { return mat(i, j); }
+
+    void set(size_t i, size_t j, double v) {
+        mat(i, j) = v;
+        markTile(g.tileOf(i, j));
+    }
+
+    // 把行 [r0, r1)、列 [c0, c1) 覆盖到的块标脏，返回矩阵供调用方修改这一区域
+    Matrix& modify(size_t r0, size_t r1, size_t c0, size_t c1) {
+        if (r0 < r1 && c0 < c1) {
+            for (size_t i = r0 / g.tileRows; i <= (r1 - 1) / g.tileRows; ++i)
+                for (size_t j = c0 / g.tileCols; j <= (c1 - 1) / g.tileCols; ++j)
+                    markTile(i * g.tilesPerRow() + j);
+        }
+        return mat;
+    }
+
+    // 有改动时推进版本并清除脏标记，返回当前版本。发布完整矩阵前调用
+    uint64_t commit() {
+        if (dirty()) {
+            ++ver;
+            clearDirty();
+        }
+        return ver;
+    }
+
+    // 自上次 commit / takeDelta 以来改动过的块，没有改动时返回空
+    std::shared_ptr<const MatrixDelta> takeDelta() {
+        if (!dirty()) return nullptr;
+        std::sort(dirtyList.begin(), dirtyList.end());
+        auto delta = std::make_shared<MatrixDelta>(g, ver, ver + 1);
+        for (size_t t : dirtyList) delta->addTile(t, mat);
+        ++ver;
+        clearDirty();
+        return delta;
+    }
+
+private:
+    void markTile(size_t t) {
+        if (!dirtyFlags[t]) {
+            dirtyFlags[t] = true;
+            dirtyList.push_back(t);
+        }
+    }
+
+    void clearDirty() {
+        for (size_t t : dirtyList) dirtyFlags[t] = false;
+        dirtyList.clear();
+    }
+
+    Matrix mat;
+    TileGrid g;
+    uint64_t ver = 0;
+    std::vector<bool> dirtyFlags;
+    std::vector<size_t> dirtyList;
+};
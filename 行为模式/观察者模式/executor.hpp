@@ -0,0 +1,121 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ------------------- 工作窃取线程池 --------------------
+// 每个工作线程一个任务队列。线程池外提交的任务轮流分给各个队列，工作线程里提交的任务进自己的队列；
+// 工作线程从自己队列的队头取任务（先进先出，反复重新投递自己的任务也不会饿死同队列里的其他任务），
+// 自己的队列空了就从别的队列的队尾偷，都没有任务时睡眠。
+class WorkStealingExecutor {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingExecutor(size_t threadCount = defaultThreads()) {
+        threadCount = std::max<size_t>(threadCount, 1);
+        for (size_t i = 0; i < threadCount; ++i)
+            workers.push_back(std::make_unique<Worker>());
+        for (size_t i = 0; i < threadCount; ++i)
+            threads.emplace_back([this, i]() { run(i); });
+    }
+
+    // 执行完所有已提交的任务后再退出
+    ~WorkStealingExecutor() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMtx);
+            stopping = true;
+        }
+        sleepCv.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+    WorkStealingExecutor& operator=(const WorkStealingExecutor&) = delete;
+
+    void post(Task task) {
+        size_t target = currentExecutor == this ? currentWorker
+                                                : nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+        {
+            std::lock_guard<std::mutex> lock(workers[target]->mtx);
+            workers[target]->tasks.push_back(std::move(task));
+        }
+        pending.fetch_add(1);
+        if (sleeping.load() > 0) {
+            std::lock_guard<std::mutex> lock(sleepMtx);
+            sleepCv.notify_one();
+        }
+    }
+
+    size_t size() const { return threads.size(); }
+
+    // 至少两个线程：一个观察者在回调里阻塞时，其余观察者仍能推进
+    static size_t defaultThreads() {
+        return std::max(2u, std::thread::hardware_concurrency());
+    }
+
+private:
+    struct Worker {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+    };
+
+    bool popLocal(size_t i, Task& task) {
+        Worker& w = *workers[i];
+        std::lock_guard<std::mutex> lock(w.mtx);
+        if (w.tasks.empty()) return false;
+        task = std::move(w.tasks.front());
+        w.tasks.pop_front();
+        return true;
+    }
+
+    bool steal(size_t thief, Task& task) {
+        for (size_t k = 1; k < workers.size(); ++k) {
+            Worker& w = *workers[(thief + k) % workers.size()];
+            std::lock_guard<std::mutex> lock(w.mtx);
+            if (w.tasks.empty()) continue;
+            task = std::move(w.tasks.back());
+            w.tasks.pop_back();
+            return true;
+        }
+        return false;
+    }
+
+    void run(size_t i) {
+        currentExecutor = this;
+        currentWorker = i;
+        Task task;
+        while (true) {
+            if (popLocal(i, task) || steal(i, task)) {
+                pending.fetch_sub(1);
+                task();
+                task = nullptr;  // 尽早释放任务捕获的对象
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMtx);
+            sleeping.fetch_add(1);
+            sleepCv.wait(lock, [this]() { return pending.load() > 0 || stopping; });
+            sleeping.fetch_sub(1);
+            if (stopping && pending.load() == 0) break;
+        }
+        currentExecutor = nullptr;
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> nextWorker{0};   // 外部提交时轮流选择队列
+    std::atomic<size_t> pending{0};      // 所有队列中的任务总数
+    std::atomic<size_t> sleeping{0};     // 正在睡眠的线程数，为 0 时提交方不必加锁唤醒
+    std::mutex sleepMtx;
+    std::condition_variable sleepCv;
+    bool stopping = false;
+
+    static inline thread_local WorkStealingExecutor* currentExecutor = nullptr;
+    static inline thread_local size_t currentWorker = 0;
+};
@@ -0,0 +1,144 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include "executor.hpp"
+#include "matrix.hpp"
+#include "reduce.hpp"
+
+// ------------------- 分块并行填充 --------------------
+// 矩阵切成大小约为 kTileBytes 的块，调用线程和线程池一起按块填充。
+// 块的列起点都是 8 的倍数，因此每块每一行的起点都在缓存行边界上。
+namespace fill {
+
+// 填充行 [r0, r1)、列 [c0, c1) 这一块；不同的块可能在不同线程上同时调用
+using TileFill = std::function<void(Matrix& mat, size_t r0, size_t r1, size_t c0, size_t c1)>;
+
+constexpr size_t kTileBytes = 256 * 1024;  // 大致是一个核的 L2 份额
+constexpr size_t kTileCols = 2048;         // 每块最多的列数，须为 8 的倍数
+
+namespace detail {
+
+// 每行从 base 开始依次加 1；base 与列号都小于 2^53 时各路径的结果逐位相同
+inline void rampScalar(double* p, size_t n, double base) {
+    for (size_t j = 0; j < n; ++j) p[j] = base + static_cast<double>(j);
+}
+
+#ifdef REDUCE_X86
+__attribute__((target("sse2")))
+inline void rampSse2(double* p, size_t n, double base) {
+    __m128d v = _mm_setr_pd(base, base + 1);
+    const __m128d step = _mm_set1_pd(2);
+    size_t j = 0;
+    for (; j + 2 <= n; j += 2, v = _mm_add_pd(v, step)) _mm_storeu_pd(p + j, v);
+    rampScalar(p + j, n - j, base + static_cast<double>(j));
+}
+
+__attribute__((target("avx2")))
+inline void rampAvx2(double* p, size_t n, double base) {
+    __m256d v0 = _mm256_setr_pd(base, base + 1, base + 2, base + 3);
+    __m256d v1 = _mm256_add_pd(v0, _mm256_set1_pd(4));
+    const __m256d step = _mm256_set1_pd(8);
+    size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        _mm256_storeu_pd(p + j, v0);
+        _mm256_storeu_pd(p + j + 4, v1);
+        v0 = _mm256_add_pd(v0, step);
+        v1 = _mm256_add_pd(v1, step);
+    }
+    rampScalar(p + j, n - j, base + static_cast<double>(j));
+}
+
+__attribute__((target("avx512f")))
+inline void rampAvx512(double* p, size_t n, double base) {
+    __m512d v = _mm512_add_pd(_mm512_set1_pd(base), _mm512_setr_pd(0, 1, 2, 3, 4, 5, 6, 7));
+    const __m512d step = _mm512_set1_pd(8);
+    size_t j = 0;
+    for (; j + 8 <= n; j += 8, v = _mm512_add_pd(v, step)) _mm512_storeu_pd(p + j, v);
+    rampScalar(p + j, n - j, base + static_cast<double>(j));
+}
+#endif
+
+inline void ramp(double* p, size_t n, double base, reduce::Isa isa) {
+    switch (isa) {
+#ifdef REDUCE_X86
+        case reduce::Isa::AVX512: rampAvx512(p, n, base); return;
+        case reduce::Isa::AVX2:   rampAvx2(p, n, base); return;
+        case reduce::Isa::SSE2:   rampSse2(p, n, base); return;
+#endif
+        default:                  rampScalar(p, n, base); return;
+    }
+}
+
+// 一次分块填充的共享状态；线程池里的帮手可能在填充结束后才开始执行，所以放在堆上
+struct Job {
+    Matrix* mat;
+    const TileFill* fn;
+    size_t tileRows, tileCols, tilesPerRow, tiles;
+    std::atomic<size_t> next{0};  // 下一个待领取的块
+    size_t done = 0;              // 已完成的块，受 mtx 保护
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    // 领取并填充块，直到没有剩余
+    void work() {
+        size_t t;
+        while ((t = next.fetch_add(1)) < tiles) {
+            size_t r0 = t / tilesPerRow * tileRows, c0 = t % tilesPerRow * tileCols;
+            (*fn)(*mat, r0, std::min(r0 + tileRows, mat->rows()), c0, std::min(c0 + tileCols, mat->cols()));
+            std::lock_guard<std::mutex> lock(mtx);
+            if (++done == tiles) cv.notify_all();
+        }
+    }
+};
+
+}  // namespace detail
+
+// 默认的填充：(i, j) = i * cols + j。rows 指向第 r0 行，相邻两行相隔 stride 个元素
+inline void indexRows(double* rows, size_t stride, size_t cols, size_t r0, size_t r1, size_t c0, size_t c1) {
+    reduce::Isa isa = reduce::detectIsa();
+    for (size_t i = r0; i < r1; ++i) {
+        detail::ramp(rows + (i - r0) * stride + c0, c1 - c0, static_cast<double>(i * cols + c0), isa);
+    }
+}
+
+inline void indexTile(Matrix& mat, size_t r0, size_t r1, size_t c0, size_t c1) {
+    indexRows(mat.row(r0).data(), mat.stride(), mat.cols(), r0, r1, c0, c1);
+}
+
+// 按块填充整个矩阵。executor 为空或矩阵只有一块时在调用线程里完成；
+// 否则调用线程也参与填充，返回时所有块都已填完。可以在线程池的工作线程里调用
+inline void fillTiles(Matrix& mat, const TileFill& fn, WorkStealingExecutor* executor = nullptr) {
+    if (mat.empty()) return;
+    size_t tileCols = std::min(mat.cols(), kTileCols);
+    size_t tileRows = std::max<size_t>(1, kTileBytes / (Matrix::alignedStride(tileCols) * sizeof(double)));
+    size_t tilesPerRow = (mat.cols() + tileCols - 1) / tileCols;
+    size_t tiles = (mat.rows() + tileRows - 1) / tileRows * tilesPerRow;
+    if (executor == nullptr || tiles == 1) {
+        for (size_t r0 = 0; r0 < mat.rows(); r0 += tileRows)
+            for (size_t c0 = 0; c0 < mat.cols(); c0 += tileCols)
+                fn(mat, r0, std::min(r0 + tileRows, mat.rows()), c0, std::min(c0 + tileCols, mat.cols()));
+        return;
+    }
+
+    auto job = std::make_shared<detail::Job>();
+    job->mat = &mat;
+    job->fn = &fn;
+    job->tileRows = tileRows;
+    job->tileCols = tileCols;
+    job->tilesPerRow = tilesPerRow;
+    job->tiles = tiles;
+    size_t helpers = std::min(executor->size(), tiles - 1);
+    for (size_t k = 0; k < helpers; ++k)
+        executor->post([job] { job->work(); });
+    job->work();
+    // 帮手一旦领到块就正在执行，等待不会依赖尚未开始的任务
+    std::unique_lock<std::mutex> lock(job->mtx);
+    job->cv.wait(lock, [&] { return job->done == job->tiles; });
+}
+
+}  // namespace fill
@@ -0,0 +1,164 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "matrix.hpp"
+
+// ------------------- 文件映射的矩阵 --------------------
+// 数据放在文件里，用 mmap 映射后按行块顺序访问，适合放不进内存的矩阵。
+// 文件格式：第一页是文件头，之后按行存放，每行补齐到 Matrix::alignedStride(cols) 个元素（补齐部分为 0），
+// 与 Matrix 的内存布局相同，所以 reduce 等按 (data, rows, cols, stride) 工作的函数可以直接用在每个行块上。
+//
+// forEachChunk / fillChunks 按行块顺序处理：整段映射提示 MADV_SEQUENTIAL，处理某一块前对下一块 MADV_WILLNEED
+// 让内核提前读入，处理完的块 MADV_DONTNEED 从本进程的页表中去掉，常驻内存大约只有两个行块，与矩阵大小无关。
+class MappedMatrix {
+public:
+    static constexpr uint64_t kMagic = 0x31585254414d4d4dULL;  // "MMMATRX1"
+    static constexpr size_t kHeaderBytes = 4096;
+    static constexpr size_t kDefaultChunkBytes = 64 << 20;
+
+    // 新建 rows x cols 的文件（已存在则覆盖），元素初始为 0；失败时返回空
+    static std::shared_ptr<MappedMatrix> create(const std::string& path, size_t rows, size_t cols) {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            std::cerr << "MappedMatrix: Failed to create " << path << std::endl;
+            return nullptr;
+        }
+        size_t stride = Matrix::alignedStride(cols);
+        size_t bytes = kHeaderBytes + rows * stride * sizeof(double);
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {  // 稀疏文件，不预先占用磁盘
+            std::cerr << "MappedMatrix: Failed to size " << path << std::endl;
+            ::close(fd);
+            return nullptr;
+        }
+        auto mat = map(path, fd, bytes, true);
+        if (mat) {
+            auto* h = reinterpret_cast<Header*>(mat->base);
+            *h = Header{kMagic, rows, cols, stride};
+            mat->nRows = rows;
+            mat->nCols = cols;
+            mat->nStride = stride;
+        }
+        return mat;
+    }
+
+    // 只读打开已有的文件；不是本格式或长度不对时返回空
+    static std::shared_ptr<MappedMatrix> open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || ::fstat(fd, &st) != 0) {
+            std::cerr << "MappedMatrix: Failed to open " << path << std::endl;
+            if (fd >= 0) ::close(fd);
+            return nullptr;
+        }
+        size_t bytes = static_cast<size_t>(st.st_size);
+        auto mat = bytes >= kHeaderBytes ? map(path, fd, bytes, false) : nullptr;
+        if (mat) {
+            const auto* h = reinterpret_cast<const Header*>(mat->base);
+            if (h->magic == kMagic && h->stride == Matrix::alignedStride(h->cols) &&
+                bytes == kHeaderBytes + h->rows * h->stride * sizeof(double)) {
+                mat->nRows = h->rows;
+                mat->nCols = h->cols;
+                mat->nStride = h->stride;
+                return mat;
+            }
+        }
+        std::cerr << "MappedMatrix: " << path << " is not a matrix file" << std::endl;
+        return nullptr;
+    }
+
+    ~MappedMatrix() {
+        ::munmap(base, bytes);
+        ::close(fd);
+    }
+
+    MappedMatrix(const MappedMatrix&) = delete;
+    MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+    const std::string& path() const { return filePath; }
+    size_t rows() const { return nRows; }
+    size_t cols() const { return nCols; }
+    size_t stride() const { return nStride; }
+    bool writable() const { return canWrite; }
+
+    // 随机访问会按需缺页，大矩阵上应尽量用 forEachChunk
+    const double* data() const { return reinterpret_cast<const double*>(base + kHeaderBytes); }
+    double operator()(size_t i, size_t j) const { return data()[i * nStride + j]; }
+
+    // fn(data, r0, r1)：data 指向第 r0 行，依次处理 [r0, r1) 行，每块约 chunkBytes 字节
+    template<typename Fn>
+    void forEachChunk(Fn&& fn, size_t chunkBytes = kDefaultChunkBytes) const {
+        stream(chunkBytes, [&](size_t r0, size_t r1) { fn(data() + r0 * nStride, r0, r1); });
+    }
+
+    // 可写时按行块填充：fn(data, r0, r1) 写第 [r0, r1) 行的前 cols 列。写完的块交给内核回写
+    template<typename Fn>
+    bool fillChunks(Fn&& fn, size_t chunkBytes = kDefaultChunkBytes) {
+        if (!canWrite) return false;
+        double* rows = reinterpret_cast<double*>(base + kHeaderBytes);
+        stream(chunkBytes, [&](size_t r0, size_t r1) { fn(rows + r0 * nStride, r0, r1); });
+        return true;
+    }
+
+private:
+    struct Header {
+        uint64_t magic;
+        uint64_t rows;
+        uint64_t cols;
+        uint64_t stride;
+    };
+
+    MappedMatrix(std::string path, int fd, char* base, size_t bytes, bool writable)
+        : filePath(std::move(path)), fd(fd), base(base), bytes(bytes), canWrite(writable) {}
+
+    static std::shared_ptr<MappedMatrix> map(const std::string& path, int fd, size_t bytes, bool writable) {
+        void* addr = ::mmap(nullptr, bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            std::cerr << "MappedMatrix: Failed to map " << path << std::endl;
+            ::close(fd);
+            return nullptr;
+        }
+        return std::shared_ptr<MappedMatrix>(new MappedMatrix(path, fd, static_cast<char*>(addr), bytes, writable));
+    }
+
+    // 按页对齐后调用 madvise；提示失败不影响正确性
+    void advise(size_t begin, size_t end, int advice) const {
+        static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        begin = begin / page * page;
+        if (end > begin) ::madvise(base + begin, end - begin, advice);
+    }
+
+    template<typename Fn>
+    void stream(size_t chunkBytes, Fn&& chunk) const {
+        if (nRows == 0) return;
+        size_t rowBytes = nStride * sizeof(double);
+        size_t chunkRows = std::max<size_t>(1, chunkBytes / rowBytes);
+        auto offset = [&](size_t r) { return kHeaderBytes + r * rowBytes; };
+        advise(0, bytes, MADV_SEQUENTIAL);
+        for (size_t r0 = 0; r0 < nRows; r0 += chunkRows) {
+            size_t r1 = std::min(r0 + chunkRows, nRows);
+            if (r1 < nRows) advise(offset(r1), offset(std::min(r1 + chunkRows, nRows)), MADV_WILLNEED);
+            chunk(r0, r1);
+            // 只丢掉整页都属于已处理行的部分，与下一块共用的那一页留着
+            static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            size_t end = r1 < nRows ? offset(r1) / page * page : bytes;
+            advise(offset(r0), end, MADV_DONTNEED);
+        }
+    }
+
+    std::string filePath;
+    int fd;
+    char* base;
+    size_t bytes;
+    bool canWrite;
+    size_t nRows = 0;
+    size_t nCols = 0;
+    size_t nStride = 0;
+};
@@ -0,0 +1,120 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <utility>
+
+// ------------------- 连续存储的矩阵 --------------------
+// 整个矩阵一次分配，按行存放。每行补齐到 64 字节，所以每一行的起点都在缓存行边界上；
+// stride 是相邻两行起点之间的元素个数，补齐部分始终为 0。
+class Matrix {
+public:
+    static constexpr size_t kAlignment = 64;
+
+    // 一行的视图，不拥有数据
+    template<typename T>
+    class RowView {
+    public:
+        RowView(T* data, size_t size) : ptr(data), len(size) {}
+
+        T& operator[](size_t j) const { return ptr[j]; }
+        T* data() const { return ptr; }
+        size_t size() const { return len; }
+        T* begin() const { return ptr; }
+        T* end() const { return ptr + len; }
+
+    private:
+        T* ptr;
+        size_t len;
+    };
+
+    Matrix() = default;  // 空矩阵
+
+    // capacity 为预留的元素个数（含补齐），不足 rows * stride 时按实际需要分配
+    Matrix(size_t rows, size_t cols, size_t capacity = 0)
+        : nRows(rows), nCols(cols), nStride(alignedStride(cols)),
+          nCapacity(capacity > rows * nStride ? capacity : rows * nStride), buf(allocate(nCapacity)) {}
+
+    Matrix(const Matrix& other) : Matrix(other.nRows, other.nCols) {
+        if (buf) std::memcpy(buf.get(), other.buf.get(), bytes());
+    }
+
+    Matrix& operator=(const Matrix& other) {
+        if (this != &other) *this = Matrix(other);
+        return *this;
+    }
+
+    Matrix(Matrix&& other) noexcept
+        : nRows(std::exchange(other.nRows, 0)), nCols(std::exchange(other.nCols, 0)),
+          nStride(std::exchange(other.nStride, 0)), nCapacity(std::exchange(other.nCapacity, 0)),
+          buf(std::move(other.buf)) {}
+
+    Matrix& operator=(Matrix&& other) noexcept {
+        nRows = std::exchange(other.nRows, 0);
+        nCols = std::exchange(other.nCols, 0);
+        nStride = std::exchange(other.nStride, 0);
+        nCapacity = std::exchange(other.nCapacity, 0);
+        buf = std::move(other.buf);
+        return *this;
+    }
+
+    // 在已有容量内改变形状，不重新分配；容量不足时返回 false。
+    // 之后元素的值不确定（调用方负责填充），补齐部分清零。
+    bool reshape(size_t rows, size_t cols) {
+        size_t stride = alignedStride(cols);
+        if (rows * stride > nCapacity) return false;
+        nRows = rows;
+        nCols = cols;
+        nStride = stride;
+        if (stride != cols) {
+            for (size_t i = 0; i < rows; ++i) {
+                std::memset(buf.get() + i * stride + cols, 0, (stride - cols) * sizeof(double));
+            }
+        }
+        return true;
+    }
+
+    size_t rows() const { return nRows; }
+    size_t cols() const { return nCols; }
+    size_t stride() const { return nStride; }
+    size_t capacity() const { return nCapacity; }  // 已分配的元素个数
+    bool empty() const { return nRows == 0 || nCols == 0; }
+
+    // cols 列时的行间隔（元素个数）
+    static size_t alignedStride(size_t cols) {
+        constexpr size_t perLine = kAlignment / sizeof(double);
+        return (cols + perLine - 1) / perLine * perLine;
+    }
+
+    double* data() { return buf.get(); }
+    const double* data() const { return buf.get(); }
+
+    RowView<double> row(size_t i) { return {buf.get() + i * nStride, nCols}; }
+    RowView<const double> row(size_t i) const { return {buf.get() + i * nStride, nCols}; }
+    RowView<double> operator[](size_t i) { return row(i); }
+    RowView<const double> operator[](size_t i) const { return row(i); }
+
+    double& operator()(size_t i, size_t j) { return buf[i * nStride + j]; }
+    double operator()(size_t i, size_t j) const { return buf[i * nStride + j]; }
+
+private:
+    struct AlignedDelete {
+        void operator()(double* p) const { ::operator delete[](p, std::align_val_t(kAlignment)); }
+    };
+
+    static std::unique_ptr<double[], AlignedDelete> allocate(size_t count) {
+        if (count == 0) return nullptr;
+        double* p = static_cast<double*>(::operator new[](count * sizeof(double), std::align_val_t(kAlignment)));
+        std::memset(p, 0, count * sizeof(double));
+        return std::unique_ptr<double[], AlignedDelete>(p);
+    }
+
+    size_t bytes() const { return nRows * nStride * sizeof(double); }
+
+    size_t nRows = 0;
+    size_t nCols = 0;
+    size_t nStride = 0;
+    size_t nCapacity = 0;
+    std::unique_ptr<double[], AlignedDelete> buf;
+};
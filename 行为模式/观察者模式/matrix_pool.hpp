@@ -0,0 +1,156 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "matrix.hpp"
+
+// ------------------- 矩阵缓冲池 --------------------
+// acquire() 返回的 shared_ptr 在最后一个持有者释放时，不把矩阵还给分配器，而是放回池中。
+// 按容量分级：第 k 级缓存容量为 2^k 个元素的矩阵，同一级内任意形状都可复用。
+// shared_ptr 的控制块也从池里取，因此预热之后生成矩阵不再有任何堆分配。
+// 池对象可以先于它发出的矩阵销毁，缓存的内存在最后一个矩阵释放后回收。
+class MatrixPool {
+public:
+    struct Stats {
+        uint64_t hits = 0;       // 从池中取到
+        uint64_t misses = 0;     // 池中没有，新分配
+        uint64_t returns = 0;    // 放回池中
+        uint64_t discards = 0;   // 该级已满，直接释放
+        size_t cached = 0;       // 池中空闲的矩阵数
+        size_t cachedBytes = 0;  // 池中空闲矩阵占用的字节数
+    };
+
+    // maxPerClass：每一级最多缓存的空闲矩阵数
+    explicit MatrixPool(size_t maxPerClass = 64) : state(std::make_shared<State>(maxPerClass)) {}
+
+    // 取一个 rows x cols 的矩阵，元素的值不确定，由调用方填充
+    std::shared_ptr<Matrix> acquire(size_t rows, size_t cols) {
+        size_t need = rows * Matrix::alignedStride(cols);
+        size_t cls = sizeClass(need);
+        Matrix* mat = state->take(cls);
+        if (mat == nullptr) {
+            mat = new Matrix(rows, cols, need > 0 ? size_t(1) << cls : 0);
+        } else {
+            mat->reshape(rows, cols);
+        }
+        return std::shared_ptr<Matrix>(mat, Recycle{state, cls}, BlockAllocator<Matrix>{state});
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(state->mtx);
+        return state->stats;
+    }
+
+private:
+    static constexpr size_t kClasses = 64;
+
+    struct State {
+        explicit State(size_t maxPerClass) : maxPerClass(maxPerClass) {}
+
+        ~State() {
+            for (auto& list : free)
+                for (Matrix* mat : list) delete mat;
+            for (void* block : blocks) ::operator delete(block);
+        }
+
+        Matrix* take(size_t cls) {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (free[cls].empty()) {
+                ++stats.misses;
+                return nullptr;
+            }
+            Matrix* mat = free[cls].back();
+            free[cls].pop_back();
+            ++stats.hits;
+            --stats.cached;
+            stats.cachedBytes -= mat->capacity() * sizeof(double);
+            return mat;
+        }
+
+        void give(size_t cls, Matrix* mat) {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (free[cls].size() < maxPerClass) {
+                    free[cls].push_back(mat);
+                    ++stats.returns;
+                    ++stats.cached;
+                    stats.cachedBytes += mat->capacity() * sizeof(double);
+                    return;
+                }
+                ++stats.discards;
+            }
+            delete mat;
+        }
+
+        // 控制块只有一种大小，第一次分配时记下，其余大小直接走 operator new
+        void* allocBlock(size_t bytes) {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (bytes == blockBytes && !blocks.empty()) {
+                    void* block = blocks.back();
+                    blocks.pop_back();
+                    return block;
+                }
+                if (blockBytes == 0) blockBytes = bytes;
+            }
+            return ::operator new(bytes);
+        }
+
+        void freeBlock(void* block, size_t bytes) {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (bytes == blockBytes) {
+                    blocks.push_back(block);
+                    return;
+                }
+            }
+            ::operator delete(block);
+        }
+
+        const size_t maxPerClass;
+        std::mutex mtx;
+        std::vector<Matrix*> free[kClasses];
+        std::vector<void*> blocks;  // 空闲的控制块
+        size_t blockBytes = 0;
+        Stats stats;
+    };
+
+    // shared_ptr 的删除器：矩阵放回池中
+    struct Recycle {
+        std::shared_ptr<State> state;
+        size_t cls;
+        void operator()(Matrix* mat) const { state->give(cls, mat); }
+    };
+
+    // shared_ptr 控制块的分配器
+    template<typename T>
+    struct BlockAllocator {
+        using value_type = T;
+
+        std::shared_ptr<State> state;
+
+        template<typename U>
+        BlockAllocator(const BlockAllocator<U>& other) : state(other.state) {}
+        explicit BlockAllocator(std::shared_ptr<State> s) : state(std::move(s)) {}
+
+        T* allocate(size_t n) { return static_cast<T*>(state->allocBlock(n * sizeof(T))); }
+        void deallocate(T* p, size_t n) { state->freeBlock(p, n * sizeof(T)); }
+
+        template<typename U>
+        bool operator==(const BlockAllocator<U>& other) const { return state == other.state; }
+        template<typename U>
+        bool operator!=(const BlockAllocator<U>& other) const { return state != other.state; }
+    };
+
+    // 容纳 n 个元素的最小级别
+    static size_t sizeClass(size_t n) {
+        size_t cls = 0;
+        while ((size_t(1) << cls) < n) ++cls;
+        return cls;
+    }
+
+    std::shared_ptr<State> state;
+};
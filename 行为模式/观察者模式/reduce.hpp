@@ -0,0 +1,417 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "matrix.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define REDUCE_X86 1
+#endif
+
+// ------------------- 向量化归约 --------------------
+// 一次遍历同时求和、最小/最大值、均值和 L2 范数，运行时按 CPU 选择 SSE2 / AVX2 / AVX-512。
+//
+// 可复现性：所有路径都按同一个 8 路 lane 结构累加——每行中第 j 个完整 8 元素块的第 l 个元素
+// 进入主 lane l，行尾不足 8 个的元素进入尾部 lane (j % 8)；最后按固定顺序合并 16 个 lane。
+// 加法顺序与向量宽度无关，因此同一模式下各指令集的结果与标量参考实现逐位相同。
+// 为此平方不允许与加法融合为 FMA，编译时也不能打开 -ffast-math（它会允许重排并消掉 Kahan 的补偿项）。
+namespace reduce {
+
+enum class Mode {
+    FAST,         // 每个 lane 直接累加
+    COMPENSATED   // 每个 lane 做 Kahan 补偿求和，合并时同样补偿
+};
+
+enum class Isa { SCALAR, SSE2, AVX2, AVX512 };
+
+struct Stats {
+    size_t count = 0;
+    double sum = 0;
+    double mean = 0;
+    double min = std::numeric_limits<double>::infinity();   // NaN 被忽略
+    double max = -std::numeric_limits<double>::infinity();
+    double l2 = 0;
+};
+
+inline const char* isaName(Isa isa) {
+    switch (isa) {
+        case Isa::SSE2:   return "SSE2";
+        case Isa::AVX2:   return "AVX2";
+        case Isa::AVX512: return "AVX-512";
+        default:          return "scalar";
+    }
+}
+
+// 当前 CPU 支持的最高路径，只检测一次
+inline Isa detectIsa() {
+    static const Isa isa = []() {
+#ifdef REDUCE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return Isa::AVX512;
+        if (__builtin_cpu_supports("avx2")) return Isa::AVX2;
+        if (__builtin_cpu_supports("sse2")) return Isa::SSE2;
+#endif
+        return Isa::SCALAR;
+    }();
+    return isa;
+}
+
+namespace detail {
+
+constexpr size_t kLanes = 8;
+
+// 各路径的中间结果：sum/sq 为和与平方和，sumErr/sqErr 为 Kahan 补偿项（FAST 模式恒为 0）。
+// 各路径都从已有的值接着累加，所以同一组 lane 可以依次处理多个行块
+struct Lanes {
+    double sum[kLanes], sumErr[kLanes], sq[kLanes], sqErr[kLanes], min[kLanes], max[kLanes];
+
+    Lanes() {
+        for (size_t l = 0; l < kLanes; ++l) {
+            sum[l] = sumErr[l] = sq[l] = sqErr[l] = 0;
+            min[l] = std::numeric_limits<double>::infinity();
+            max[l] = -std::numeric_limits<double>::infinity();
+        }
+    }
+};
+
+// 阻止编译器把 x * x 与随后的加法融合成 FMA，否则有无 FMA 的路径结果不同
+template<typename T>
+inline void keep(T& v) {
+#ifdef REDUCE_X86
+    asm("" : "+x"(v));
+#else
+    (void)v;
+#endif
+}
+
+inline void kahan(double& s, double& c, double x) {
+    double y = x - c;
+    double t = s + y;
+    c = (t - s) - y;
+    s = t;
+}
+
+// min/max 的写法与 minpd/maxpd 一致：x 为 NaN 时保留原值
+inline double laneMin(double x, double m) { return x < m ? x : m; }
+inline double laneMax(double x, double m) { return x > m ? x : m; }
+
+template<bool Comp>
+inline void step(Lanes& a, size_t l, double x) {
+    double x2 = x * x;
+    keep(x2);
+    if constexpr (Comp) {
+        kahan(a.sum[l], a.sumErr[l], x);
+        kahan(a.sq[l], a.sqErr[l], x2);
+    } else {
+        a.sum[l] += x;
+        a.sq[l] += x2;
+    }
+    a.min[l] = laneMin(x, a.min[l]);
+    a.max[l] = laneMax(x, a.max[l]);
+}
+
+// 行尾不足一个块的元素，所有路径共用
+template<bool Comp>
+inline void tails(const double* data, size_t rows, size_t cols, size_t stride, Lanes& tail) {
+    size_t blocks = cols / kLanes * kLanes;
+    for (size_t i = 0; i < rows; ++i) {
+        const double* p = data + i * stride;
+        for (size_t j = blocks; j < cols; ++j) step<Comp>(tail, j - blocks, p[j]);
+    }
+}
+
+template<bool Comp>
+inline void blocksScalar(const double* data, size_t rows, size_t cols, size_t stride, Lanes& out) {
+    size_t blocks = cols / kLanes * kLanes;
+    for (size_t i = 0; i < rows; ++i) {
+        const double* p = data + i * stride;
+        for (size_t j = 0; j < blocks; j += kLanes)
+            for (size_t l = 0; l < kLanes; ++l) step<Comp>(out, l, p[j + l]);
+    }
+}
+
+#ifdef REDUCE_X86
+
+template<bool Comp>
+__attribute__((target("sse2")))
+inline void blocksSse2(const double* data, size_t rows, size_t cols, size_t stride, Lanes& out) {
+    constexpr size_t W = 2, R = kLanes / W;
+    __m128d s[R], c[R], q[R], qc[R], lo[R], hi[R];
+    for (size_t r = 0; r < R; ++r) {
+        s[r] = _mm_loadu_pd(out.sum + r * W);
+        c[r] = _mm_loadu_pd(out.sumErr + r * W);
+        q[r] = _mm_loadu_pd(out.sq + r * W);
+        qc[r] = _mm_loadu_pd(out.sqErr + r * W);
+        lo[r] = _mm_loadu_pd(out.min + r * W);
+        hi[r] = _mm_loadu_pd(out.max + r * W);
+    }
+    size_t blocks = cols / kLanes * kLanes;
+    for (size_t i = 0; i < rows; ++i) {
+        const double* p = data + i * stride;
+        for (size_t j = 0; j < blocks; j += kLanes) {
+            for (size_t r = 0; r < R; ++r) {
+                __m128d x = _mm_loadu_pd(p + j + r * W);
+                __m128d x2 = _mm_mul_pd(x, x);
+                keep(x2);
+                if constexpr (Comp) {
+                    __m128d y = _mm_sub_pd(x, c[r]);
+                    __m128d t = _mm_add_pd(s[r], y);
+                    c[r] = _mm_sub_pd(_mm_sub_pd(t, s[r]), y);
+                    s[r] = t;
+                    y = _mm_sub_pd(x2, qc[r]);
+                    t = _mm_add_pd(q[r], y);
+                    qc[r] = _mm_sub_pd(_mm_sub_pd(t, q[r]), y);
+                    q[r] = t;
+                } else {
+                    s[r] = _mm_add_pd(s[r], x);
+                    q[r] = _mm_add_pd(q[r], x2);
+                }
+                lo[r] = _mm_min_pd(x, lo[r]);
+                hi[r] = _mm_max_pd(x, hi[r]);
+            }
+        }
+    }
+    for (size_t r = 0; r < R; ++r) {
+        _mm_storeu_pd(out.sum + r * W, s[r]);
+        _mm_storeu_pd(out.sumErr + r * W, c[r]);
+        _mm_storeu_pd(out.sq + r * W, q[r]);
+        _mm_storeu_pd(out.sqErr + r * W, qc[r]);
+        _mm_storeu_pd(out.min + r * W, lo[r]);
+        _mm_storeu_pd(out.max + r * W, hi[r]);
+    }
+}
+
+template<bool Comp>
+__attribute__((target("avx2")))
+inline void blocksAvx2(const double* data, size_t rows, size_t cols, size_t stride, Lanes& out) {
+    constexpr size_t W = 4, R = kLanes / W;
+    __m256d s[R], c[R], q[R], qc[R], lo[R], hi[R];
+    for (size_t r = 0; r < R; ++r) {
+        s[r] = _mm256_loadu_pd(out.sum + r * W);
+        c[r] = _mm256_loadu_pd(out.sumErr + r * W);
+        q[r] = _mm256_loadu_pd(out.sq + r * W);
+        qc[r] = _mm256_loadu_pd(out.sqErr + r * W);
+        lo[r] = _mm256_loadu_pd(out.min + r * W);
+        hi[r] = _mm256_loadu_pd(out.max + r * W);
+    }
+    size_t blocks = cols / kLanes * kLanes;
+    for (size_t i = 0; i < rows; ++i) {
+        const double* p = data + i * stride;
+        for (size_t j = 0; j < blocks; j += kLanes) {
+            for (size_t r = 0; r < R; ++r) {
+                __m256d x = _mm256_loadu_pd(p + j + r * W);
+                __m256d x2 = _mm256_mul_pd(x, x);
+                keep(x2);
+                if constexpr (Comp) {
+                    __m256d y = _mm256_sub_pd(x, c[r]);
+                    __m256d t = _mm256_add_pd(s[r], y);
+                    c[r] = _mm256_sub_pd(_mm256_sub_pd(t, s[r]), y);
+                    s[r] = t;
+                    y = _mm256_sub_pd(x2, qc[r]);
+                    t = _mm256_add_pd(q[r], y);
+                    qc[r] = _mm256_sub_pd(_mm256_sub_pd(t, q[r]), y);
+                    q[r] = t;
+                } else {
+                    s[r] = _mm256_add_pd(s[r], x);
+                    q[r] = _mm256_add_pd(q[r], x2);
+                }
+                lo[r] = _mm256_min_pd(x, lo[r]);
+                hi[r] = _mm256_max_pd(x, hi[r]);
+            }
+        }
+    }
+    for (size_t r = 0; r < R; ++r) {
+        _mm256_storeu_pd(out.sum + r * W, s[r]);
+        _mm256_storeu_pd(out.sumErr + r * W, c[r]);
+        _mm256_storeu_pd(out.sq + r * W, q[r]);
+        _mm256_storeu_pd(out.sqErr + r * W, qc[r]);
+        _mm256_storeu_pd(out.min + r * W, lo[r]);
+        _mm256_storeu_pd(out.max + r * W, hi[r]);
+    }
+}
+
+template<bool Comp>
+__attribute__((target("avx512f")))
+inline void blocksAvx512(const double* data, size_t rows, size_t cols, size_t stride, Lanes& out) {
+    __m512d s = _mm512_loadu_pd(out.sum), c = _mm512_loadu_pd(out.sumErr);
+    __m512d q = _mm512_loadu_pd(out.sq), qc = _mm512_loadu_pd(out.sqErr);
+    __m512d lo = _mm512_loadu_pd(out.min), hi = _mm512_loadu_pd(out.max);
+    size_t blocks = cols / kLanes * kLanes;
+    for (size_t i = 0; i < rows; ++i) {
+        const double* p = data + i * stride;
+        for (size_t j = 0; j < blocks; j += kLanes) {
+            __m512d x = _mm512_loadu_pd(p + j);
+            __m512d x2 = _mm512_mul_pd(x, x);
+            keep(x2);
+            if constexpr (Comp) {
+                __m512d y = _mm512_sub_pd(x, c);
+                __m512d t = _mm512_add_pd(s, y);
+                c = _mm512_sub_pd(_mm512_sub_pd(t, s), y);
+                s = t;
+                y = _mm512_sub_pd(x2, qc);
+                t = _mm512_add_pd(q, y);
+                qc = _mm512_sub_pd(_mm512_sub_pd(t, q), y);
+                q = t;
+            } else {
+                s = _mm512_add_pd(s, x);
+                q = _mm512_add_pd(q, x2);
+            }
+            // 与 minpd/maxpd 同义；GCC 12 的 _mm512_min_pd 会误报未初始化
+            lo = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, lo, _CMP_LT_OQ), lo, x);
+            hi = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, hi, _CMP_GT_OQ), hi, x);
+        }
+    }
+    _mm512_storeu_pd(out.sum, s);
+    _mm512_storeu_pd(out.sumErr, c);
+    _mm512_storeu_pd(out.sq, q);
+    _mm512_storeu_pd(out.sqErr, qc);
+    _mm512_storeu_pd(out.min, lo);
+    _mm512_storeu_pd(out.max, hi);
+}
+
+#endif  // REDUCE_X86
+
+// 按固定顺序合并主 lane 与尾部 lane
+template<bool Comp>
+inline double combine(const double (&main)[kLanes], const double (&mainErr)[kLanes],
+                      const double (&tail)[kLanes], const double (&tailErr)[kLanes]) {
+    double s = 0, c = 0;
+    for (size_t l = 0; l < kLanes; ++l) {
+        if constexpr (Comp) {
+            kahan(s, c, main[l]);
+            kahan(s, c, -mainErr[l]);
+            kahan(s, c, tail[l]);
+            kahan(s, c, -tailErr[l]);
+        } else {
+            s += main[l];
+            s += tail[l];
+        }
+    }
+    return s;
+}
+
+// 把 rows 行累加进 main / tail
+template<bool Comp>
+inline void accumulate(const double* data, size_t rows, size_t cols, size_t stride, Isa isa,
+                       Lanes& main, Lanes& tail) {
+    switch (isa) {
+#ifdef REDUCE_X86
+        case Isa::AVX512: blocksAvx512<Comp>(data, rows, cols, stride, main); break;
+        case Isa::AVX2:   blocksAvx2<Comp>(data, rows, cols, stride, main); break;
+        case Isa::SSE2:   blocksSse2<Comp>(data, rows, cols, stride, main); break;
+#endif
+        default:          blocksScalar<Comp>(data, rows, cols, stride, main); break;
+    }
+    tails<Comp>(data, rows, cols, stride, tail);
+}
+
+template<bool Comp>
+inline Stats finish(const Lanes& main, const Lanes& tail, size_t count) {
+    Stats st;
+    st.count = count;
+    if (st.count == 0) return st;
+    st.sum = combine<Comp>(main.sum, main.sumErr, tail.sum, tail.sumErr);
+    st.l2 = std::sqrt(combine<Comp>(main.sq, main.sqErr, tail.sq, tail.sqErr));
+    st.mean = st.sum / static_cast<double>(st.count);
+    for (size_t l = 0; l < kLanes; ++l) {
+        st.min = laneMin(main.min[l], laneMin(tail.min[l], st.min));
+        st.max = laneMax(main.max[l], laneMax(tail.max[l], st.max));
+    }
+    return st;
+}
+
+template<bool Comp>
+inline Stats run(const double* data, size_t rows, size_t cols, size_t stride, Isa isa) {
+    Lanes main, tail;
+    accumulate<Comp>(data, rows, cols, stride, isa, main, tail);
+    return finish<Comp>(main, tail, rows * cols);
+}
+
+}  // namespace detail
+
+// 对 rows 行、每行 cols 个元素、行首间隔 stride 个元素的数据做归约。
+// isa 高于 CPU 支持的级别时自动降级；Isa::SCALAR 即标量参考实现。
+inline Stats reduce(const double* data, size_t rows, size_t cols, size_t stride,
+                    Mode mode = Mode::FAST, Isa isa = detectIsa()) {
+    if (isa > detectIsa()) isa = detectIsa();
+    return mode == Mode::COMPENSATED ? detail::run<true>(data, rows, cols, stride, isa)
+                                     : detail::run<false>(data, rows, cols, stride, isa);
+}
+
+inline Stats reduce(const Matrix& mat, Mode mode = Mode::FAST, Isa isa = detectIsa()) {
+    return reduce(mat.data(), mat.rows(), mat.cols(), mat.stride(), mode, isa);
+}
+
+// 按行块流式归约：把一个矩阵从上到下切成若干行块依次 add，各 lane 的状态（含 Kahan 补偿项）
+// 跨块保留，结果与对整个矩阵调用 reduce 逐位相同。各块的列数必须相同
+class Accumulator {
+public:
+    explicit Accumulator(Mode mode = Mode::FAST, Isa isa = detectIsa())
+        : mode(mode), isa(isa > detectIsa() ? detectIsa() : isa) {}
+
+    void add(const double* data, size_t rows, size_t cols, size_t stride) {
+        if (mode == Mode::COMPENSATED) {
+            detail::accumulate<true>(data, rows, cols, stride, isa, main, tail);
+        } else {
+            detail::accumulate<false>(data, rows, cols, stride, isa, main, tail);
+        }
+        count += rows * cols;
+    }
+
+    Stats result() const {
+        return mode == Mode::COMPENSATED ? detail::finish<true>(main, tail, count)
+                                         : detail::finish<false>(main, tail, count);
+    }
+
+private:
+    Mode mode;
+    Isa isa;
+    detail::Lanes main, tail;
+    size_t count = 0;
+};
+
+// 自检：在 FAST 和 COMPENSATED 两种模式下，比较本机支持的每条向量路径与标量参考实现，要求逐位一致。
+// 列数覆盖 1 到 17（不足一块、正好一块、一块多几个）以及几种较大的不规则形状
+inline bool selfTest() {
+    std::vector<std::pair<size_t, size_t>> shapes = {{17, 33}, {64, 100}, {3, 1029}, {1, 4099}};
+    for (size_t cols = 1; cols <= 17; ++cols) shapes.push_back({2 + cols % 5, cols});
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    auto same = [](double a, double b) { return std::memcmp(&a, &b, sizeof(double)) == 0; };
+
+    for (auto& shape : shapes) {
+        Matrix mat(shape.first, shape.second);
+        for (size_t i = 0; i < mat.rows(); ++i) {
+            for (double& v : mat.row(i)) {
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                int exponent = static_cast<int>(seed >> 59) - 16;  // 混合量级悬殊的正负数
+                v = std::ldexp(static_cast<double>(static_cast<int64_t>(seed) >> 11), exponent - 52);
+            }
+        }
+        auto matches = [&](const Stats& st, const Stats& ref) {
+            return same(st.sum, ref.sum) && same(st.mean, ref.mean) && same(st.l2, ref.l2) &&
+                   same(st.min, ref.min) && same(st.max, ref.max);
+        };
+        for (Mode mode : {Mode::FAST, Mode::COMPENSATED}) {
+            Stats ref = reduce(mat, mode, Isa::SCALAR);
+            for (Isa isa : {Isa::SCALAR, Isa::SSE2, Isa::AVX2, Isa::AVX512}) {
+                if (isa > detectIsa()) break;
+                if (!matches(reduce(mat, mode, isa), ref)) return false;
+                // 按 2 行一块流式归约，结果也要逐位一致
+                Accumulator acc(mode, isa);
+                for (size_t r0 = 0; r0 < mat.rows(); r0 += 2)
+                    acc.add(mat.row(r0).data(), std::min<size_t>(2, mat.rows() - r0), mat.cols(), mat.stride());
+                if (!matches(acc.result(), ref)) return false;
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace reduce
@@ -0,0 +1,86 @@
+// 跨进程观察者：g++ -std=c++17 -O2 -pthread shm.cpp（glibc 2.34 之前还要 -lrt）
+// 用法：
+//   shm                         一个发布者进程 + 两个 fork 出来的订阅者进程
+//   shm pub [frames]            只做发布者，等至少一个订阅者连上后开始发布
+//   shm sub compute|render      只做订阅者，与另一个终端里的 shm pub 配合
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "reduce.hpp"
+#include "shm_ring.hpp"
+
+static const char* kName = "/matrix-ring";
+static const size_t kRows = 100, kCols = 100;
+
+// 等到至少 waitFor 个订阅者连上后发布 frames 帧。第 k 帧：(i, j) = k + i * cols + j，
+// 订阅者据此检查读到的数据是否完整
+static void publishFrames(shm::Publisher& pub, size_t frames, unsigned waitFor) {
+    while (pub.subscribers() < waitFor) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    auto start = std::chrono::steady_clock::now();
+    for (size_t k = 0; k < frames; ++k) {
+        pub.publish(kRows, kCols, [k](double* data, size_t stride) {
+            for (size_t i = 0; i < kRows; ++i)
+                for (size_t j = 0; j < kCols; ++j)
+                    data[i * stride + j] = static_cast<double>(k + i * kCols + j);
+        });
+        std::this_thread::sleep_for(std::chrono::microseconds(100)); // 模拟生成的间隔
+    }
+    pub.close();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "[Publisher] " << frames << " frames in " << ms << " ms" << std::endl;
+}
+
+// compute 处理每一帧；render 每帧要 20ms，跟不上时被套圈，只看到较新的帧
+static int subscriber(const std::string& role) {
+    shm::Subscriber sub(kName);
+    if (!sub) return 1;
+    bool render = role == "render";
+    size_t seen = 0, torn = 0;
+    shm::Frame frame;
+    while (sub.next(frame, std::chrono::milliseconds(5000))) {
+        double k = frame(0, 0);
+        reduce::Stats st = reduce::reduce(frame.data(), frame.rows(), frame.cols(), frame.stride());
+        double n = static_cast<double>(frame.rows() * frame.cols());
+        if (st.min != k || st.max != k + n - 1 || st.sum != n * k + n * (n - 1) / 2) ++torn;
+        ++seen;
+        if (render) std::this_thread::sleep_for(std::chrono::milliseconds(20)); // 模拟耗时，期间一直持有这一帧
+    }
+    std::cout << "[" << role << "] pid " << ::getpid() << ": read " << seen << " frames, lost " << sub.lost()
+              << ", torn " << torn << std::endl;
+    return torn == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "sub") return subscriber(argc > 2 ? argv[2] : "compute");
+
+    shm::Publisher pub(kName, 16, kRows, kCols);
+    if (!pub) return 1;
+    if (mode == "pub") {
+        publishFrames(pub, argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000, 1);
+        return 0;
+    }
+
+    // 先建好共享内存段再 fork 订阅者，两个订阅者都连上后才开始发布
+    pid_t children[2];
+    const char* roles[2] = {"compute", "render"};
+    std::cout.flush();
+    for (int c = 0; c < 2; ++c) {
+        children[c] = ::fork();
+        if (children[c] == 0) ::_exit(subscriber(roles[c]));
+    }
+    publishFrames(pub, 2000, 2);
+    int rc = 0;
+    for (pid_t child : children) {
+        int status = 0;
+        ::waitpid(child, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) rc = 1;
+    }
+    std::cout << (rc == 0 ? "ok" : "FAILED") << std::endl;
+    return rc;
+}
@@ -0,0 +1,356 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "matrix.hpp"
+
+// ------------------- 跨进程共享内存环 --------------------
+// 发布者把每个矩阵只写一次到 POSIX 共享内存（shm_open）里的某个槽位，其他进程的订阅者映射同一段内存，
+// 直接读槽位里的数据，不拷贝、不序列化。
+//
+// 最近 window 帧可以读：索引环的第 n % window 项记着第 n 帧在哪个槽位。槽位比 window 多出 spare 个，
+// 订阅者读一帧期间持有该槽位的引用计数，发布者只往既不在索引里、引用计数又为 0 的槽位写，
+// 所以慢订阅者长时间持有一帧只占住一个备用槽位，既不会读到被改写的数据，也不会拖住发布者；
+// 同时持有的帧超过 spare 个时发布者才会等待（订阅者持有引用时崩溃，会永久占住那个槽位）。
+// 发布者从不等订阅者的读进度：落后超过 window 帧的订阅者被套圈，直接跳到最新一帧，并记下丢了几帧。
+//
+// 发布者先把槽位序号置为 kWriting，再检查引用计数；订阅者先加引用，再检查槽位序号。
+// 两边都是 seq_cst，至少有一方能看到对方的写入：要么订阅者看到序号已变而放弃，要么发布者看到引用而另选槽位。
+namespace shm {
+
+constexpr uint32_t kMagic = 0x4d545852;  // "MTXR"
+
+namespace detail {
+
+constexpr int64_t kWriting = -2;
+
+struct alignas(64) Slot {
+    std::atomic<int64_t> seq{-1};   // 槽位里是哪一帧；-1 为空，kWriting 为正在写
+    std::atomic<uint32_t> refs{0};  // 正在读这个槽位的订阅者数
+    uint64_t rows = 0;
+    uint64_t cols = 0;
+    uint64_t stride = 0;
+};
+
+struct alignas(64) Header {
+    std::atomic<uint32_t> magic{0};  // 发布者初始化完后最后写入
+    uint32_t window = 0;          // 索引环的长度
+    uint32_t slotCount = 0;
+    uint64_t slotBytes = 0;       // 每个槽位占的字节数，含 Slot 头
+    uint64_t capacity = 0;        // 每个槽位最多能放的元素个数（含行补齐）
+    alignas(64) std::atomic<int64_t> cursor{-1};  // 已发布的最大序号
+    std::atomic<uint32_t> closed{0};
+    std::atomic<uint32_t> subscribers{0};        // 当前连接的订阅者数，仅供参考
+};
+
+static_assert(std::atomic<int64_t>::is_always_lock_free, "跨进程使用的原子量必须是无锁的");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "跨进程使用的原子量必须是无锁的");
+
+inline size_t slotBytes(size_t capacity) {
+    return sizeof(Slot) + capacity * sizeof(double);  // Slot 头是 64 字节的倍数，数据也在缓存行边界上
+}
+
+// 索引环紧跟在 Header 之后，槽位从下一个缓存行开始
+inline size_t indexBytes(size_t window) {
+    return (window * sizeof(std::atomic<uint32_t>) + 63) / 64 * 64;
+}
+
+inline size_t totalBytes(size_t window, size_t slotCount, size_t capacity) {
+    return sizeof(Header) + indexBytes(window) + slotCount * slotBytes(capacity);
+}
+
+inline std::atomic<uint32_t>* indexAt(Header* h, size_t pos) {
+    return reinterpret_cast<std::atomic<uint32_t>*>(h + 1) + pos;
+}
+
+inline Slot* slotAt(Header* h, size_t i) {
+    return reinterpret_cast<Slot*>(reinterpret_cast<char*>(h + 1) + indexBytes(h->window) + i * h->slotBytes);
+}
+
+inline double* slotData(Slot* s) {
+    return reinterpret_cast<double*>(s + 1);
+}
+
+// 先自旋让出 CPU，之后每次睡 50us
+inline void backoff(unsigned& spins) {
+    if (++spins < 64) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+}  // namespace detail
+
+// 创建共享内存段并发布矩阵；析构时标记关闭并删除段名（已映射的订阅者仍可读完）
+class Publisher {
+public:
+    // name 形如 "/matrix-ring"；同名的旧段会被替换。maxRows x maxCols 为单帧最大尺寸，
+    // window 为可读的最近帧数，spare 为订阅者可以同时长时间持有的帧数
+    Publisher(const std::string& name, size_t window, size_t maxRows, size_t maxCols, size_t spare = 4)
+        : name(name), inIndex(window + spare), slotOf(window, kNoSlot) {
+        size_t slotCount = window + spare;
+        size_t capacity = maxRows * Matrix::alignedStride(maxCols);
+        bytes = detail::totalBytes(window, slotCount, capacity);
+        ::shm_unlink(name.c_str());
+        int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0) {
+            std::cerr << "shm: Failed to create " << name << std::endl;
+            return;
+        }
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            std::cerr << "shm: Failed to size " << name << std::endl;
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            return;
+        }
+        void* addr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED) {
+            std::cerr << "shm: Failed to map " << name << std::endl;
+            ::shm_unlink(name.c_str());
+            return;
+        }
+        header = new (addr) detail::Header();
+        header->window = static_cast<uint32_t>(window);
+        header->slotCount = static_cast<uint32_t>(slotCount);
+        header->slotBytes = detail::slotBytes(capacity);
+        header->capacity = capacity;
+        for (size_t i = 0; i < window; ++i) new (detail::indexAt(header, i)) std::atomic<uint32_t>(kNoSlot);
+        for (size_t i = 0; i < slotCount; ++i) new (detail::slotAt(header, i)) detail::Slot();
+        header->magic.store(kMagic);
+    }
+
+    ~Publisher() {
+        if (header == nullptr) return;
+        close();
+        ::munmap(header, bytes);
+        ::shm_unlink(name.c_str());
+    }
+
+    Publisher(const Publisher&) = delete;
+    Publisher& operator=(const Publisher&) = delete;
+
+    explicit operator bool() const { return header != nullptr; }
+
+    // fill(data, stride) 直接在共享内存里填写 rows x cols 的矩阵，行间隔为 stride 个元素。
+    // 返回帧序号；尺寸超出创建时的上限时返回 -1
+    template<typename Fill>
+    int64_t publish(size_t rows, size_t cols, Fill&& fill) {
+        size_t stride = Matrix::alignedStride(cols);
+        if (header == nullptr || rows * stride > header->capacity) {
+            std::cerr << "shm: Matrix " << rows << "x" << cols << " does not fit in a slot" << std::endl;
+            return -1;
+        }
+        int64_t seq = ++claimed;
+        size_t pos = static_cast<size_t>(seq % header->window);
+        if (slotOf[pos] != kNoSlot) inIndex[slotOf[pos]] = false;  // 第 seq - window 帧移出可读范围
+        uint32_t id = claimSlot();
+        detail::Slot* s = detail::slotAt(header, id);
+        s->rows = rows;
+        s->cols = cols;
+        s->stride = stride;
+        double* data = detail::slotData(s);
+        fill(data, stride);
+        if (stride != cols) {
+            for (size_t i = 0; i < rows; ++i)
+                std::memset(data + i * stride + cols, 0, (stride - cols) * sizeof(double));
+        }
+        s->seq.store(seq);
+        inIndex[id] = true;
+        slotOf[pos] = id;
+        detail::indexAt(header, pos)->store(id);
+        header->cursor.store(seq);
+        return seq;
+    }
+
+    // 把已有的矩阵拷进共享内存
+    int64_t publish(const Matrix& mat) {
+        return publish(mat.rows(), mat.cols(), [&](double* data, size_t stride) {
+            for (size_t i = 0; i < mat.rows(); ++i)
+                std::memcpy(data + i * stride, mat.row(i).data(), mat.cols() * sizeof(double));
+        });
+    }
+
+    // 订阅者读完已发布的帧后 next() 返回 false
+    void close() {
+        if (header) header->closed.store(1);
+    }
+
+    uint32_t subscribers() const {
+        return header ? header->subscribers.load() : 0;
+    }
+
+private:
+    static constexpr uint32_t kNoSlot = UINT32_MAX;
+
+    // 找一个不在索引里、也没有订阅者持有的槽位，并把它标记为正在写
+    uint32_t claimSlot() {
+        for (unsigned spins = 0;; detail::backoff(spins)) {
+            for (size_t k = 0; k < inIndex.size(); ++k) {
+                uint32_t id = static_cast<uint32_t>(nextSlot++ % inIndex.size());
+                if (inIndex[id]) continue;
+                detail::Slot* s = detail::slotAt(header, id);
+                if (s->refs.load() != 0) continue;
+                s->seq.store(detail::kWriting);
+                if (s->refs.load() == 0) return id;  // 之后来的订阅者会看到 kWriting 而放弃
+                s->seq.store(-1);                    // 恰好有订阅者拿着旧索引来读，换一个
+            }
+        }
+    }
+
+    std::string name;
+    size_t bytes = 0;
+    detail::Header* header = nullptr;
+    int64_t claimed = -1;
+    std::vector<bool> inIndex;     // 槽位是否在索引里，只有发布者访问
+    std::vector<uint32_t> slotOf;  // 索引环的本地副本
+    size_t nextSlot = 0;
+};
+
+// 订阅者读到的一帧：直接指向共享内存，持有期间槽位不会被覆盖，应尽快释放
+class Frame {
+public:
+    Frame() = default;
+
+    Frame(Frame&& other) noexcept : slot(std::exchange(other.slot, nullptr)), seqNo(other.seqNo) {}
+
+    Frame& operator=(Frame&& other) noexcept {
+        if (this != &other) {
+            release();
+            slot = std::exchange(other.slot, nullptr);
+            seqNo = other.seqNo;
+        }
+        return *this;
+    }
+
+    ~Frame() {
+        release();
+    }
+
+    void release() {
+        if (slot) slot->refs.fetch_sub(1);
+        slot = nullptr;
+    }
+
+    explicit operator bool() const { return slot != nullptr; }
+
+    int64_t seq() const { return seqNo; }
+    size_t rows() const { return slot->rows; }
+    size_t cols() const { return slot->cols; }
+    size_t stride() const { return slot->stride; }
+    const double* data() const { return detail::slotData(slot); }
+
+    Matrix::RowView<const double> row(size_t i) const { return {data() + i * stride(), cols()}; }
+    double operator()(size_t i, size_t j) const { return data()[i * stride() + j]; }
+
+private:
+    friend class Subscriber;
+
+    Frame(detail::Slot* slot, int64_t seq) : slot(slot), seqNo(seq) {}
+
+    detail::Slot* slot = nullptr;
+    int64_t seqNo = -1;
+};
+
+// 映射发布者创建的共享内存段，从连接之后发布的下一帧开始读
+class Subscriber {
+public:
+    explicit Subscriber(const std::string& name) {
+        int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            std::cerr << "shm: Failed to open " << name << std::endl;
+            return;
+        }
+        struct stat st;
+        void* addr = MAP_FAILED;
+        if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(detail::Header)) {
+            bytes = static_cast<size_t>(st.st_size);
+            addr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);  // 引用计数要写
+        }
+        ::close(fd);
+        if (addr == MAP_FAILED) {
+            std::cerr << "shm: Failed to map " << name << std::endl;
+            return;
+        }
+        auto* h = static_cast<detail::Header*>(addr);
+        if (h->magic.load() != kMagic ||
+            bytes < detail::totalBytes(h->window, h->slotCount, h->capacity)) {
+            std::cerr << "shm: " << name << " is not an initialized matrix ring" << std::endl;
+            ::munmap(addr, bytes);
+            return;
+        }
+        header = h;
+        header->subscribers.fetch_add(1);
+        nextSeq = header->cursor.load() + 1;
+    }
+
+    ~Subscriber() {
+        if (header == nullptr) return;
+        header->subscribers.fetch_sub(1);
+        ::munmap(header, bytes);
+    }
+
+    Subscriber(const Subscriber&) = delete;
+    Subscriber& operator=(const Subscriber&) = delete;
+
+    explicit operator bool() const { return header != nullptr; }
+
+    // 等下一帧，最多等 timeout；超时、或发布者已关闭且读完时返回 false。
+    // 之前取到的 out 会先被释放
+    bool next(Frame& out, std::chrono::milliseconds timeout = std::chrono::milliseconds::max()) {
+        out.release();
+        if (header == nullptr) return false;
+        auto deadline = timeout == std::chrono::milliseconds::max()
+                            ? std::chrono::steady_clock::time_point::max()
+                            : std::chrono::steady_clock::now() + timeout;
+        unsigned spins = 0;
+        while (true) {
+            int64_t cursor = header->cursor.load();
+            if (cursor < nextSeq) {
+                if (header->closed.load() && header->cursor.load() < nextSeq) return false;
+                if (std::chrono::steady_clock::now() >= deadline) return false;
+                detail::backoff(spins);
+                continue;
+            }
+            if (cursor - nextSeq >= static_cast<int64_t>(header->window)) {  // 被套圈，直接跳到最新一帧
+                lostFrames += static_cast<uint64_t>(cursor - nextSeq);
+                nextSeq = cursor;
+            }
+            uint32_t id = detail::indexAt(header, static_cast<size_t>(nextSeq % header->window))->load();
+            detail::Slot* s = detail::slotAt(header, id);
+            s->refs.fetch_add(1);
+            if (s->seq.load() == nextSeq) {
+                out = Frame(s, nextSeq++);
+                return true;
+            }
+            s->refs.fetch_sub(1);  // 读之前这一帧已被移出可读范围，下一轮按套圈处理
+
+        }
+    }
+
+    // 因为读得慢被覆盖、没读到的帧数
+    uint64_t lost() const {
+        return lostFrames;
+    }
+
+private:
+    size_t bytes = 0;
+    detail::Header* header = nullptr;
+    int64_t nextSeq = 0;
+    uint64_t lostFrames = 0;
+};
+
+}  // namespace shm
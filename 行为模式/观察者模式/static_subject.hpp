@@ -0,0 +1,75 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "matrix.hpp"
+
+// ------------------- 编译期确定的被观察者 --------------------
+// 观察者列表是模板参数，通知时直接调用各观察者的成员函数，没有虚调用，编译器可以内联。
+//
+// 观察者有两种：
+//   - 只有 onMatrixGenerated(const Matrix&) 的，整个矩阵交给它自己处理；
+//   - 声明了行块内核的，即同时提供
+//       void onBegin(const Matrix& mat);
+//       void onRows(const double* rows, size_t r0, size_t r1, size_t cols, size_t stride); // rows 指向第 r0 行
+//       void onEnd(const Matrix& mat);
+//     这些观察者合并成一次遍历：矩阵按 kStripBytes 切成行块，每个行块依次交给所有内核后再读下一块，
+//     行块在各内核之间一直留在缓存里，N 个观察者只读一遍内存。
+namespace detail {
+
+template<typename T, typename = void>
+struct HasRowKernel : std::false_type {};
+
+template<typename T>
+struct HasRowKernel<T, std::void_t<decltype(std::declval<T&>().onRows(
+                           std::declval<const double*>(), size_t{}, size_t{}, size_t{}, size_t{}))>>
+    : std::true_type {};
+
+}  // namespace detail
+
+template<typename... Observers>
+class StaticSubject {
+public:
+    static constexpr size_t kStripBytes = 256 * 1024;  // 大致是一个核的 L2 份额
+    static constexpr size_t kKernels = (0 + ... + size_t{detail::HasRowKernel<Observers>::value});
+
+    // 只保存引用，观察者的生命周期由调用方负责
+    explicit StaticSubject(Observers&... obs) : observers(obs...) {}
+
+    void notify(const Matrix& mat) {
+        std::apply([&](auto&... obs) { (begin(obs, mat), ...); }, observers);
+        if constexpr (kKernels > 0) {
+            size_t strip = std::max<size_t>(1, kStripBytes / (std::max<size_t>(1, mat.stride()) * sizeof(double)));
+            for (size_t r0 = 0; r0 < mat.rows(); r0 += strip) {
+                size_t r1 = std::min(r0 + strip, mat.rows());
+                const double* rows = mat.row(r0).data();
+                std::apply([&](auto&... obs) { (kernel(obs, rows, r0, r1, mat), ...); }, observers);
+            }
+            std::apply([&](auto&... obs) { (end(obs, mat), ...); }, observers);
+        }
+    }
+
+private:
+    template<typename T>
+    static void begin(T& obs, const Matrix& mat) {
+        if constexpr (detail::HasRowKernel<T>::value) {
+            obs.onBegin(mat);
+        } else {
+            obs.onMatrixGenerated(mat);
+        }
+    }
+
+    template<typename T>
+    static void kernel(T& obs, const double* rows, size_t r0, size_t r1, const Matrix& mat) {
+        if constexpr (detail::HasRowKernel<T>::value) obs.onRows(rows, r0, r1, mat.cols(), mat.stride());
+    }
+
+    template<typename T>
+    static void end(T& obs, const Matrix& mat) {
+        if constexpr (detail::HasRowKernel<T>::value) obs.onEnd(mat);
+    }
+
+    std::tuple<Observers&...> observers;
+};
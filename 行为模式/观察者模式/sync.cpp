@@ -1,10 +1,12 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <vector>
 #include <memory>
 #include <string>
-
-// 假设矩阵就是一个二维vector
-using Matrix = std::vector<std::vector<double>>;
+#include "matrix.hpp"
+#include "reduce.hpp"
+#include "static_subject.hpp"
 
 // 观察者接口
 class IMatrixObserver {
@@ -13,7 +15,18 @@ public:
     virtual ~IMatrixObserver() = default;
 };
 
-// 被观察者（Subject）
+// 简单填充数据
+Matrix makeMatrix(size_t rows, size_t cols) {
+    Matrix mat(rows, cols);
+    for (size_t i = 0; i < rows; ++i) {
+        double* row = mat.row(i).data();
+        for (size_t j = 0; j < cols; ++j)
+            row[j] = static_cast<double>(i * cols + j);
+    }
+    return mat;
+}
+
+// 被观察者（Subject）：运行时增删观察者，每个观察者一次虚调用，各自遍历整个矩阵
 class MatrixGenerator {
     std::vector<IMatrixObserver*> observers;
 public:
@@ -22,19 +35,11 @@ public:
     }
 
     void generateMatrix(size_t rows, size_t cols) {
-        Matrix mat(rows, std::vector<double>(cols, 0.0));
-
-        // 简单填充数据
-        for (size_t i = 0; i < rows; ++i)
-            for (size_t j = 0; j < cols; ++j)
-                mat[i][j] = static_cast<double>(i * cols + j);
-
+        Matrix mat = makeMatrix(rows, cols);
         std::cout << "[MatrixGenerator] Matrix generated: " << rows << "x" << cols << "\n";
-
         notifyObservers(mat);
     }
 
-private:
     void notifyObservers(const Matrix& mat) {
         for (auto* obs : observers) {
             obs->onMatrixGenerated(mat);
@@ -42,38 +47,115 @@ private:
     }
 };
 
-// 日志系统
-class LoggerSystem : public IMatrixObserver {
+// 观察者在编译期确定的被观察者：静态分发，声明了行块内核的观察者合并为一次遍历
+template<typename... Observers>
+class StaticMatrixGenerator {
+    StaticSubject<Observers...> subject;
+public:
+    explicit StaticMatrixGenerator(Observers&... obs) : subject(obs...) {}
+
+    void generateMatrix(size_t rows, size_t cols) {
+        Matrix mat = makeMatrix(rows, cols);
+        std::cout << "[StaticMatrixGenerator] Matrix generated: " << rows << "x" << cols << "\n";
+        notifyObservers(mat);
+    }
+
+    void notifyObservers(const Matrix& mat) {
+        subject.notify(mat);
+    }
+};
+
+// 日志系统：不读矩阵内容，不需要内核
+class LoggerSystem final : public IMatrixObserver {
 public:
     void onMatrixGenerated(const Matrix& mat) override {
         std::cout << "[LoggerSystem] Matrix of size "
-                  << mat.size() << "x" << mat[0].size() << " received.\n";
+                  << mat.rows() << "x" << mat.cols() << " received.\n";
     }
 };
 
-// 渲染系统
-class RenderSystem : public IMatrixObserver {
+// 渲染系统：预览为左上角两个元素加一张 2x2 的缩略图（每格是对应四分之一矩阵的均值），要读整个矩阵
+class RenderSystem final : public IMatrixObserver {
+    double preview[2] = {0, 0};
+    reduce::Accumulator thumb[2][2];
+    size_t midRow = 0, midCol = 0;
 public:
     void onMatrixGenerated(const Matrix& mat) override {
+        onBegin(mat);
+        if (mat.rows() > 0) onRows(mat.data(), 0, mat.rows(), mat.cols(), mat.stride());
+        onEnd(mat);
+    }
+
+    // 行块内核，供 StaticSubject 合并遍历
+    void onBegin(const Matrix& mat) {
+        preview[0] = preview[1] = 0;
+        for (auto& row : thumb)
+            for (auto& cell : row) cell = reduce::Accumulator();
+        midRow = mat.rows() / 2;
+        midCol = mat.cols() / 2;
+    }
+
+    void onRows(const double* rows, size_t r0, size_t r1, size_t cols, size_t stride) {
+        if (r0 == 0) {
+            for (size_t j = 0; j < std::min<size_t>(cols, 2); ++j) preview[j] = rows[j];
+        }
+        // 行块可能跨过中线，分成上下两段
+        for (size_t band = 0; band < 2; ++band) {
+            size_t b0 = std::max(r0, band == 0 ? 0 : midRow), b1 = std::min(r1, band == 0 ? midRow : r1);
+            if (b0 >= b1) continue;
+            const double* p = rows + (b0 - r0) * stride;
+            thumb[band][0].add(p, b1 - b0, midCol, stride);
+            thumb[band][1].add(p + midCol, b1 - b0, cols - midCol, stride);
+        }
+    }
+
+    void onEnd(const Matrix&) {
         std::cout << "[RenderSystem] Visualizing matrix preview...\n";
-        std::cout << "  [0][0] = " << mat[0][0] << ", [0][1] = " << mat[0][1] << "\n";
+        std::cout << "  [0][0] = " << preview[0] << ", [0][1] = " << preview[1] << "\n";
+        std::cout << "  thumbnail = [" << thumb[0][0].result().mean << ", " << thumb[0][1].result().mean << "; "
+                  << thumb[1][0].result().mean << ", " << thumb[1][1].result().mean << "]\n";
     }
 };
 
 // 计算系统
-class ComputeSystem : public IMatrixObserver {
+class ComputeSystem final : public IMatrixObserver {
+    reduce::Mode mode;
+    reduce::Accumulator acc; // 合并遍历时跨行块累计
 public:
+    explicit ComputeSystem(reduce::Mode mode = reduce::Mode::FAST) : mode(mode) {}
+
     void onMatrixGenerated(const Matrix& mat) override {
-        double sum = 0;
-        for (const auto& row : mat)
-            for (double v : row)
-                sum += v;
-        std::cout << "[ComputeSystem] Matrix sum = " << sum << "\n";
+        print(reduce::reduce(mat, mode));
+    }
+
+    // 行块内核：各行块依次进入同一个向量化的累加器，两种模式下结果都与 onMatrixGenerated 逐位相同
+    void onBegin(const Matrix&) {
+        acc = reduce::Accumulator(mode);
+    }
+
+    void onRows(const double* rows, size_t r0, size_t r1, size_t cols, size_t stride) {
+        acc.add(rows, r1 - r0, cols, stride);
+    }
+
+    void onEnd(const Matrix&) {
+        print(acc.result());
+    }
+
+private:
+    void print(const reduce::Stats& st) const {
+        std::cout << "[ComputeSystem] Matrix sum = " << st.sum << ", mean = " << st.mean
+                  << ", min = " << st.min << ", max = " << st.max << ", L2 = " << st.l2 << "\n";
     }
 };
 
 // ------------------- Main ---------------------
 int main() {
+    // 各指令集路径与标量参考实现逐位比对，不一致时以非零状态退出
+    bool kernelsMatch = reduce::selfTest();
+    std::cout << "[reduce] " << reduce::isaName(reduce::detectIsa()) << " kernels "
+              << (kernelsMatch ? "match" : "DO NOT match") << " the scalar reference\n";
+    if (!kernelsMatch) return 1;
+
     MatrixGenerator generator;
 
     LoggerSystem logger;
@@ -85,5 +167,20 @@ int main() {
     generator.addObserver(&calculator);
 
     generator.generateMatrix(3, 3);  // 模拟生成一个 3x3 矩阵
+
+    // 同样三个观察者，编译期绑定：渲染和计算都要读整个矩阵，合并为一次遍历
+    StaticMatrixGenerator fused(logger, renderer, calculator);
+    fused.generateMatrix(3, 3);
+
+    // 大矩阵上比较两种通知方式的耗时（不含生成）：逐个通知时渲染和计算各读一遍内存，合并后只读一遍
+    Matrix big = makeMatrix(4096, 4096);
+    auto time = [&](auto& gen) {
+        auto start = std::chrono::steady_clock::now();
+        gen.notifyObservers(big);
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    double dynamicMs = time(generator);
+    double fusedMs = time(fused);
+    std::cout << "[Notify] 4096x4096: virtual " << dynamicMs << " ms, fused " << fusedMs << " ms\n";
     return 0;
 }
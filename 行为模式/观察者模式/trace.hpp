@@ -0,0 +1,243 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// ------------------- 逐矩阵的延迟追踪 --------------------
+// 每个矩阵在流水线上的几个时刻（都是 Tracer::now()，构造 Tracer 以来的纳秒数）：
+//   生成器：开始填充 → 填充完成（generated）→ 发布完成（发布时等待慢观察者的时间也在这一段）
+//   观察者：进入自己的队列（enqueued）→ 开始处理（dequeued）→ 处理完成（completed）
+// 每个观察者一条轨道，统计排队（dequeued - enqueued）、处理（completed - dequeued）、
+// 端到端（completed - generated）三个直方图；keepEvents 为 true 时还保存每个事件，
+// 可以导出为 Chrome trace-event JSON，在 chrome://tracing 或 Perfetto 里查看。
+class Tracer {
+public:
+    static constexpr size_t kBuckets = 40;  // 第 i 格：[2^i, 2^(i+1)) 纳秒，最后一格包括更长的
+
+    // 直方图的快照
+    struct Histogram {
+        uint64_t count = 0;
+        uint64_t maxNs = 0;
+        uint64_t buckets[kBuckets] = {};
+
+        // p 分位（0~1），返回所在格的上界（纳秒）
+        uint64_t percentile(double p) const {
+            if (count == 0) return 0;
+            uint64_t rank = static_cast<uint64_t>(p * count);
+            uint64_t seen = 0;
+            for (size_t i = 0; i < kBuckets; ++i) {
+                seen += buckets[i];
+                if (seen > rank || seen == count) return std::min(uint64_t(1) << (i + 1), maxNs);
+            }
+            return maxNs;
+        }
+    };
+
+    struct TrackStats {
+        std::string name;
+        Histogram queue;    // 排队
+        Histogram service;  // 处理
+        Histogram total;    // 端到端
+        uint64_t dropped = 0;  // 没处理就被丢弃的矩阵（CONFLATE）
+    };
+
+    explicit Tracer(bool keepEvents = false)
+        : keepEvents(keepEvents), epoch(std::chrono::steady_clock::now()) {
+        addTrack("generator");
+    }
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    int64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    // 在开始记录之前调用，返回轨道号；0 号轨道是生成器
+    size_t addTrack(std::string name) {
+        tracks.push_back(std::make_unique<Track>());
+        tracks.back()->name = std::move(name);
+        return tracks.size() - 1;
+    }
+
+    // 生成器线程调用
+    void recordGenerate(uint64_t seq, int64_t start, int64_t generated, int64_t published) {
+        Track& t = *tracks[0];
+        t.service.record(generated - start);
+        t.queue.record(published - generated);  // 生成器这条轨道的“排队”是发布时被反压的时间
+        if (keepEvents) {
+            std::lock_guard<std::mutex> lock(eventsMtx);
+            events.push_back({0, seq, start, generated, published});
+        }
+    }
+
+    // 同一条轨道不能并发调用；不同轨道可以
+    void recordObserver(size_t track, uint64_t seq, int64_t generated, int64_t enqueued,
+                        int64_t dequeued, int64_t completed) {
+        Track& t = *tracks[track];
+        t.queue.record(dequeued - enqueued);
+        t.service.record(completed - dequeued);
+        t.total.record(completed - generated);
+        if (keepEvents) {
+            std::lock_guard<std::mutex> lock(eventsMtx);
+            events.push_back({track, seq, enqueued, dequeued, completed});
+        }
+    }
+
+    void recordDropped(size_t track, uint64_t n) {
+        tracks[track]->dropped.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    std::vector<TrackStats> stats() const {
+        std::vector<TrackStats> out;
+        for (auto& t : tracks) {
+            out.push_back({t->name, t->queue.snapshot(), t->service.snapshot(), t->total.snapshot(),
+                           t->dropped.load(std::memory_order_relaxed)});
+        }
+        return out;
+    }
+
+    // 每条轨道一行：次数、排队 / 处理 / 端到端的 p50、p99 和最大值
+    void report(std::ostream& os) const {
+        auto us = [](uint64_t ns) { return ns / 1000.0; };
+        auto line = [&](const char* what, const Histogram& h) {
+            os << "  " << std::left << std::setw(8) << what << std::right << std::fixed << std::setprecision(1)
+               << " n = " << h.count << ", p50 = " << us(h.percentile(0.5)) << " us, p99 = "
+               << us(h.percentile(0.99)) << " us, max = " << us(h.maxNs) << " us\n";
+        };
+        auto all = stats();
+        for (size_t i = 0; i < all.size(); ++i) {
+            const TrackStats& t = all[i];
+            os << "[Trace] " << t.name;
+            if (t.dropped > 0) os << " (dropped " << t.dropped << ")";
+            os << "\n";
+            if (i == 0) {
+                line("fill", t.service);
+                line("publish", t.queue);
+            } else {
+                line("queue", t.queue);
+                line("service", t.service);
+                line("total", t.total);
+            }
+        }
+        os.unsetf(std::ios::floatfield);
+        os << std::setprecision(6);
+    }
+
+    // 需要 keepEvents；每条轨道显示为一个线程，处理过程是完整事件，排队是异步事件
+    void writeChromeTrace(std::ostream& os) const {
+        std::vector<Event> copy;
+        {
+            std::lock_guard<std::mutex> lock(eventsMtx);
+            copy = events;
+        }
+        auto us = [](int64_t ns) { return ns / 1000.0; };
+        os << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+        bool first = true;
+        auto sep = [&]() -> std::ostream& {
+            if (!first) os << ",\n";
+            first = false;
+            return os;
+        };
+        std::vector<std::string> names;  // 已转义，可以直接放进 JSON 字符串
+        for (size_t i = 0; i < tracks.size(); ++i) {
+            names.push_back(jsonEscape(tracks[i]->name));
+            sep() << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << i
+                  << R"(,"args":{"name":")" << names[i] << "\"}}";
+        }
+        for (const Event& e : copy) {
+            const std::string& name = names[e.track];
+            const char* begin = e.track == 0 ? "fill" : "process";
+            int64_t from = e.track == 0 ? e.a : e.b;
+            int64_t to = e.track == 0 ? e.b : e.c;
+            sep() << R"({"name":")" << begin << R"(","cat":")" << name << R"(","ph":"X","pid":1,"tid":)"
+                  << e.track << ",\"ts\":" << us(from) << ",\"dur\":" << us(to - from)
+                  << R"(,"args":{"seq":)" << e.seq << "}}";
+            const char* wait = e.track == 0 ? "publish" : "queue";
+            from = e.track == 0 ? e.b : e.a;
+            to = e.track == 0 ? e.c : e.b;
+            sep() << R"({"name":")" << wait << R"(","cat":")" << name << R"(","ph":"b","pid":1,"tid":)"
+                  << e.track << ",\"id\":" << e.seq << ",\"ts\":" << us(from) << "}";
+            sep() << R"({"name":")" << wait << R"(","cat":")" << name << R"(","ph":"e","pid":1,"tid":)"
+                  << e.track << ",\"id\":" << e.seq << ",\"ts\":" << us(to) << "}";
+        }
+        os << "\n]}\n";
+        os.unsetf(std::ios::floatfield);
+        os << std::setprecision(6);
+    }
+
+private:
+    // JSON 字符串里 '"'、'\\' 和控制字符必须转义，否则 chrome://tracing 拒绝整个文件
+    static std::string jsonEscape(const std::string& s) {
+        std::string out;
+        out.reserve(s.size());
+        for (char ch : s) {
+            auto c = static_cast<unsigned char>(ch);
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += ch;
+            } else if (c < 0x20) {
+                static const char hex[] = "0123456789abcdef";
+                out += "\\u00";
+                out += hex[c >> 4];
+                out += hex[c & 0xf];
+            } else {
+                out += ch;
+            }
+        }
+        return out;
+    }
+
+    // 同一直方图只有一个写者，计数用 load + store 即可；其他线程随时可以读快照
+    struct LiveHistogram {
+        std::atomic<uint64_t> maxNs{0};
+        std::atomic<uint64_t> buckets[kBuckets] = {};
+
+        void record(int64_t ns) {
+            uint64_t v = ns > 0 ? static_cast<uint64_t>(ns) : 0;
+            size_t bucket = std::min<size_t>(63 - __builtin_clzll(v | 1), kBuckets - 1);
+            auto& counter = buckets[bucket];
+            counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            if (v > maxNs.load(std::memory_order_relaxed)) maxNs.store(v, std::memory_order_relaxed);
+        }
+
+        Histogram snapshot() const {
+            Histogram h;
+            for (size_t i = 0; i < kBuckets; ++i) {
+                h.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+                h.count += h.buckets[i];
+            }
+            h.maxNs = maxNs.load(std::memory_order_relaxed);
+            return h;
+        }
+    };
+
+    struct Track {
+        std::string name;
+        LiveHistogram queue;
+        LiveHistogram service;
+        LiveHistogram total;
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    // 生成器：a = 开始填充，b = 填充完成，c = 发布完成；观察者：a = 入队，b = 开始处理，c = 处理完成
+    struct Event {
+        size_t track;
+        uint64_t seq;
+        int64_t a, b, c;
+    };
+
+    const bool keepEvents;
+    const std::chrono::steady_clock::time_point epoch;
+    std::vector<std::unique_ptr<Track>> tracks;
+    mutable std::mutex eventsMtx;
+    std::vector<Event> events;
+};